@@ -7,6 +7,9 @@
  *
  */
 
+/* For MAP_ANONYMOUS and madvise() with -std=c11. */
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
@@ -15,6 +18,16 @@
 #include <ctype.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
 
 #include "sl.h"
 
@@ -31,31 +44,534 @@
 #define sl_base(s)     ((sl_base_p)((s)-(sizeof(sl_s))))
 #define sl_len(s)      (((sl_base_p)((s)-(sizeof(sl_s))))->len)
 #define sl_len1(s)     ((((sl_base_p)((s)-(sizeof(sl_s))))->len)+1)
-#define sl_res(s)      (((sl_base_p)((s)-(sizeof(sl_s))))->res)
+#define sl_res(s)      ((((sl_base_p)((s)-(sizeof(sl_s))))->res)&~SL_EXT_FLAG)
 #define sl_end(s)      ((char*)((s)+sl_len(s)))
 
 #define sc_len(s)      strlen(s)
 #define sc_len1(s)     (strlen(s)+1)
+
+#define sl_size_max    (SL_EXT_FLAG-1)
+#define sl_is_ext(b)   ((b)->res & SL_EXT_FLAG)
+#define sl_ext(b)      (((sl_ext_p)(b))-1)
+#define sl_align(n)    (((n)+15) & ~((size_t)15))
+#define sl_within(s,p) (((p) >= (s)) && ((p) < ((s)+sl_res(s))))
+#define sl_talign(n)   (((n)+sizeof(sl_size_t)-1) & ~(sizeof(sl_size_t)-1))
 /* clang-format on */
 
 
 
+/* ------------------------------------------------------------
+ * Internal types.
+ * ------------------------------------------------------------ */
+
+/** Storage kinds for SLs with extension header. */
+typedef enum
+{
+    SL_KIND_ARENA = 1, /**< Arena storage. */
+    SL_KIND_USE,       /**< User storage (see sl_use()). */
+    SL_KIND_HEAP,      /**< Heap storage (see sl_new_hashable()). */
+    SL_KIND_SHARED,    /**< Shared immutable storage (see sl_share()). */
+    SL_KIND_MAPPED,    /**< Mapped file (see sl_map_file()). */
+} sl_kind_t;
+
+
+/**
+ * SL extension header. Located just before SL descriptor, when
+ * SL_EXT_FLAG is set.
+ */
+typedef struct
+{
+    union
+    {
+        void*  owner; /**< Storage owner. */
+        size_t refs;  /**< Reference count (shared storage). */
+        size_t size;  /**< Mapping size (mapped storage). */
+    };
+    uint32_t kind; /**< Storage kind. */
+    uint32_t hash; /**< Cached hash (or 0). */
+} sl_ext_s;
+
+typedef sl_ext_s* sl_ext_p;
+
+
+/** Arena chunk. */
+typedef struct sl_chunk_s
+{
+    struct sl_chunk_s* next;      /**< Next chunk. */
+    size_t             size;      /**< Data size. */
+    size_t             used;      /**< Data used. */
+    size_t             pad;       /**< Unused. */
+    char               data[ 0 ]; /**< Data. */
+} sl_chunk_s;
+
+typedef sl_chunk_s* sl_chunk_p;
+
+
+/** Arena. */
+struct sl_arena_s
+{
+    sl_chunk_p head; /**< First chunk. */
+    sl_chunk_p cur;  /**< Current chunk. */
+    char*      last; /**< Latest allocation. */
+    size_t     size; /**< Default chunk size. */
+};
+
+typedef struct sl_arena_s* sl_arena_p;
+
+#define SL_ARENA_CHUNK 4096
+
+
+/**
+ * Search pattern. Plain pattern (without skip table) is used
+ * internally for one-shot searches.
+ */
+struct sl_pattern_s
+{
+    char*     ndl;  /**< Needle. */
+    size_t    nlen; /**< Needle length. */
+    uint32_t* skip; /**< Horspool skip table (or NULL). */
+};
+
+typedef struct sl_pattern_s* sl_pattern_p;
+
+/** Shortest needle for Horspool search. */
+#define SL_PATTERN_SKIP_MIN 4
+
+
+/** Rope node, i.e. treap node with SL chunk. */
+typedef struct sl_rope_node_s sl_rope_node_s;
+typedef sl_rope_node_s*       sl_rope_node_p;
+
+struct sl_rope_node_s
+{
+    sl_rope_node_p left;  /**< Preceding content. */
+    sl_rope_node_p right; /**< Following content. */
+    sl_t           str;   /**< Chunk. */
+    size_t         size;  /**< Subtree content size. */
+    uint32_t       prio;  /**< Treap priority. */
+};
+
+/** Rope. */
+struct sl_rope_s
+{
+    sl_rope_node_p root; /**< Root node. */
+    uint32_t       seed; /**< Priority generator state. */
+};
+
+/** Maximum chunk size for in-place edits. */
+#define SL_ROPE_LEAF 2048
+
+#define SL_MAP_GROUP 16     /**< Control bytes probed at once. */
+#define SL_MAP_EMPTY 0x80   /**< Empty slot. */
+#define SL_MAP_DELETED 0xfe /**< Removed entry. */
+#define SL_INTERN_BITS 6    /**< Intern table shard count (log2). */
+
+
+/** Map slot. */
+typedef struct
+{
+    sl_t  key; /**< Key (hashable SL, owned by map). */
+    void* val; /**< Value. */
+} sl_map_slot_s;
+
+/**
+ * Map, i.e. open addressing hash table. Control byte per slot is
+ * either SL_MAP_EMPTY, SL_MAP_DELETED, or 7 bits of key hash. Control
+ * bytes are probed in groups, and first group is cloned after the
+ * last slot, so that group can start at any slot.
+ */
+struct sl_map_s
+{
+    uint8_t*       ctrl; /**< Control bytes (cap + SL_MAP_GROUP). */
+    sl_map_slot_s* slot; /**< Slots. */
+    size_t         cap;  /**< Slot count (power of two). */
+    size_t         cnt;  /**< Entry count. */
+    size_t         left; /**< Empty slots left before resize. */
+};
+
+typedef struct sl_map_s* sl_map_p;
+
+
+/**
+ * String table. Strings are packed to "data" as records:
+ *
+ *     [len][str][null][pad]
+ *
+ * Record length field is at the same offset from string as SL length,
+ * hence sl_len() works for table strings (only for reading). Records
+ * are aligned to sl_size_t.
+ */
+struct sl_table_s
+{
+    char*      data; /**< Records. */
+    size_t     used; /**< Used data size. */
+    size_t     size; /**< Data storage size. */
+    sl_size_t* off;  /**< String offsets in "data". */
+    sl_size_t  cnt;  /**< String count. */
+    sl_size_t  res;  /**< Offset storage size. */
+};
+
+
+/** Intern table shard. */
+typedef struct
+{
+    pthread_mutex_t lock;  /**< Shard lock. */
+    sl_map_p        map;   /**< Canonical SLs (as keys). */
+    sl_arena_t      arena; /**< Canonical SL storage. */
+} sl_intern_shard_s;
+
+
+/** Intern table, i.e. canonical SLs in independently locked shards. */
+struct sl_intern_s
+{
+    sl_intern_shard_s shard[ 1 << SL_INTERN_BITS ]; /**< Shards. */
+};
+
+
+/** Sort item, string with cached key bytes. */
+typedef struct
+{
+    uint64_t key; /**< 8 bytes from sort depth (big-endian). */
+    char*    str; /**< String. */
+} sl_sort_item_s;
+
+/** Strings are SLs, i.e. have length (internal sort flag). */
+#define SL_SORT_LEN 0x10000
+
+/** Insertion sort threshold. */
+#define SL_SORT_INSERT 16
+
+/** Sort buckets, i.e. end and byte values. */
+#define SL_SORT_BUCKETS 257
+
+/** Maximum threads for parallel sort. */
+#define SL_SORT_THREADS_MAX 256
+
+/** Smallest array sorted in parallel. */
+#define SL_SORT_PARALLEL_MIN 65536
+
+/** Samples per thread for parallel sort splitters. */
+#define SL_SORT_SAMPLES 64
+
+/** Parallel sort state. */
+typedef struct
+{
+    char**    sa;    /**< Sorted array. */
+    char**    out;   /**< Distributed array. */
+    size_t    len;   /**< Array length. */
+    int       nthr;  /**< Thread count. */
+    int       flags; /**< Sort flags. */
+    char**    split; /**< Bucket splitters (nthr-1). */
+    int       nbkt;  /**< Bucket count (2*nthr-1). */
+    uint16_t* bkt;   /**< Bucket of each string. */
+    size_t*   cnt;   /**< Bucket counts per thread (nthr*nbkt). */
+} sl_psort_s;
+
+/** Parallel task, i.e. function run by each thread. */
+typedef void ( *sl_par_fn_t )( void* arg, int idx );
+
+/** Parallel task phases. */
+typedef struct
+{
+    sl_par_fn_t*    fn;    /**< Task of each phase. */
+    int             nfn;   /**< Phase count. */
+    void*           arg;   /**< Task argument. */
+    pthread_mutex_t lock;  /**< Phase lock. */
+    pthread_cond_t  cond;  /**< Phase done or started. */
+    int             phase; /**< Current phase. */
+    int             done;  /**< Threads done with phase. */
+} sl_par_s;
+
+/** Parallel task thread. */
+typedef struct
+{
+    pthread_t thr; /**< Thread. */
+    sl_par_s* par; /**< Task phases. */
+    int       idx; /**< Thread index. */
+} sl_par_thread_s;
+
+
+/** Quick Format conversion spec. */
+typedef struct
+{
+    char conv;  /**< Conversion char. */
+    int  flags; /**< Conversion flags. */
+    int  width; /**< Field width. */
+    int  prec;  /**< Precision (or -1). */
+} sl_fmt_spec_s;
+
+/** Quick Format flags. */
+#define SL_FMT_LEFT 1 /**< Left justify. */
+#define SL_FMT_ZERO 2 /**< Zero padding. */
+#define SL_FMT_LONG 4 /**< 64-bit argument. */
+
+/** Maximum Quick Format precision. */
+#define SL_FMT_PREC_MAX 40
+
+/** Conversion buffer size (largest double with precision). */
+#define SL_FMT_BUF 400
+
+/** Conversions with argument. */
+#define SL_FMT_CONVS "sScidIuUxXfg"
+
+/** Quick Format argument. */
+typedef struct
+{
+    union
+    {
+        uint64_t    u; /**< Integer magnitude. */
+        double      d; /**< Double magnitude. */
+        const char* s; /**< String. */
+        char        c; /**< Char. */
+    } v;
+    int         sign; /**< Sign char (or 0). */
+    const char* text; /**< Converted text (or NULL). */
+    sl_size_t   tlen; /**< Converted text length. */
+} sl_fmt_arg_s;
+
+/** Compiled format item, literal when "spec.conv" is 0. */
+typedef struct
+{
+    sl_fmt_spec_s spec; /**< Conversion spec. */
+    const char*   lit;  /**< Literal text. */
+    sl_size_t     len;  /**< Literal length. */
+} sl_fmt_item_s;
+
+/** Compiled format. */
+struct sl_fmt_s
+{
+    sl_size_t     cnt;    /**< Item count. */
+    sl_size_t     args;   /**< Conversion count. */
+    sl_size_t     lit;    /**< Total literal length. */
+    sl_fmt_item_s item[]; /**< Items. */
+};
+
+typedef struct sl_fmt_s* sl_fmt_p;
+
+/** Arguments stored without heap allocation. */
+#define SL_FMT_ARGS 16
+
+/** Storage for converted doubles during apply. */
+#define SL_FMT_SCRATCH 1024
+
+
+/** Bignum for exact double conversion. */
+typedef struct
+{
+    int      n;        /**< Used words. */
+    uint32_t w[ 40 ];  /**< Words, least significant first. */
+} sl_big_s;
+
+typedef sl_big_s* sl_big_p;
+
+
+/** Aho-Corasick automaton node. */
+typedef struct
+{
+    int32_t  child; /**< First child node. */
+    int32_t  next;  /**< Next sibling node. */
+    int32_t  fail;  /**< Failure node. */
+    int32_t  out;   /**< Longest pattern ending at node (or -1). */
+    uint32_t depth; /**< Node depth. */
+    uint32_t c;     /**< Transition char. */
+} sl_ac_node_s;
+
+typedef sl_ac_node_s* sl_ac_node_p;
+
+
+/** Match found by Aho-Corasick scan. */
+typedef struct
+{
+    size_t   pos; /**< Match position. */
+    uint32_t idx; /**< Pattern index. */
+} sl_ac_match_s;
+
+/** Block size for reversed Aho-Corasick scan. */
+#define SL_AC_BLOCK 4096
+
+
+/** Pool free list block. */
+typedef struct sl_block_s
+{
+    struct sl_block_s* next; /**< Next free block. */
+} sl_block_s;
+
+typedef sl_block_s* sl_block_p;
+
+
+/** Per-thread pool. */
+typedef struct
+{
+    sl_block_p     list[ SL_POOL_CLASSES ]; /**< Free lists. */
+    sl_pool_stat_s stat;                    /**< Statistics. */
+    int            init;                    /**< Exit handler registered. */
+} sl_pool_s;
+
+/** Smallest pool block size. */
+#define SL_POOL_MIN 16
+
+/** Free list length limit. */
+#define SL_POOL_DEPTH 1024
+
+
+
+/* ------------------------------------------------------------
+ * Configuration.
+ * ------------------------------------------------------------ */
+
+static sl_grow_t sl_grow_policy = SL_GROW_EXACT;
+static sl_size_t sl_grow_factor = 50;
+static int       sl_pool_on = 0;
+
+static _Thread_local sl_pool_s sl_pool;
+
+/** Process wide count of class sized blocks in use. */
+static int64_t sl_pool_used[ SL_POOL_CLASSES ];
+
+static pthread_key_t  sl_pool_key;
+static pthread_once_t sl_pool_once = PTHREAD_ONCE_INIT;
+
+/** Decimal digit pairs for integer conversion. */
+static const char sl_digit_pairs[ 201 ] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/** Powers of 10 for bignum scaling. */
+static const uint32_t sl_pow10[ 10 ] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/** Powers of 10 for integer digit count. */
+static const uint64_t sl_pow10_u64[ 20 ] = { 1ULL,
+                                             10ULL,
+                                             100ULL,
+                                             1000ULL,
+                                             10000ULL,
+                                             100000ULL,
+                                             1000000ULL,
+                                             10000000ULL,
+                                             100000000ULL,
+                                             1000000000ULL,
+                                             10000000000ULL,
+                                             100000000000ULL,
+                                             1000000000000ULL,
+                                             10000000000000ULL,
+                                             100000000000000ULL,
+                                             1000000000000000ULL,
+                                             10000000000000000ULL,
+                                             100000000000000000ULL,
+                                             1000000000000000000ULL,
+                                             10000000000000000000ULL };
+
+
+
 /* ------------------------------------------------------------
  * Utility functions.
  * ------------------------------------------------------------ */
 
 static char* sl_copy_setup( char* dst, char* src );
+static sl_size_t sl_grow_size( sl_size_t res, sl_size_t size, sl_grow_t grow );
+static sl_t sl_grow( sl_p sp, uint64_t size );
+static sl_base_p sl_heap_alloc( sl_size_t size );
+static sl_base_p sl_heap_resize( sl_base_p s, sl_size_t size );
+static void sl_heap_free( sl_base_p s );
+static int sl_pool_class( sl_size_t size );
+static sl_base_p sl_pool_get( int cls );
+static void sl_pool_put( sl_base_p s, int cls );
+static void sl_pool_release( sl_pool_s* pool );
+static void sl_pool_init( void );
+static sl_base_p sl_ext_resize( sl_base_p s, sl_size_t size );
+static void sl_ext_free( sl_base_p s );
+static sl_base_p sl_arena_alloc( sl_arena_p a, sl_size_t size );
+static sl_base_p sl_arena_resize( sl_arena_p a, sl_base_p s, sl_size_t size );
+static void sl_arena_free( sl_arena_p a, sl_base_p s );
+static sl_base_p sl_use_resize( sl_base_p s, sl_size_t size );
+static sl_base_p sl_hashable_resize( sl_base_p s, sl_size_t size );
+static sl_base_p sl_shared_resize( sl_base_p s, sl_size_t size );
+static void sl_shared_free( sl_base_p s );
+static void sl_unshare( sl_p sp );
+static void sl_unhash( sl_t ss );
+static sl_base_p sl_mapped_resize( sl_base_p s, sl_size_t size );
+static void sl_mapped_free( sl_base_p s );
 static off_t sl_file_size( const char* filename );
-static sl_size_t sl_norm_idx( sl_t ss, int idx );
+static sl_size_t sl_norm_idx( sl_size_t len, sl_pos_t idx );
 static sl_t sl_copy_base( sl_p s1, char* s2, sl_size_t len1 );
-static int sl_compare_base( const void* s1, const void* s2 );
+static inline uint64_t sl_be64( uint64_t w );
+static uint64_t sl_sort_key( char* str, size_t depth, int flags );
+static inline int sl_sort_bucket( sl_sort_item_s* item, size_t depth, int flags );
+static void sl_sort_insert( sl_sort_item_s* it, size_t n, size_t depth, int flags );
+static int sl_compare_bin_base( const char* s1, size_t l1, const char* s2, size_t l2 );
+static void sl_sort_radix( sl_sort_item_s* it, sl_sort_item_s* aux, size_t n, size_t depth, int flags );
+static void sl_sort_base( char** sa, size_t len, int flags );
+static void* sl_par_entry( void* arg );
+static void sl_par_run( int nthreads, sl_par_fn_t* fn, int nfn, void* arg );
+static void sl_psort_classify( void* arg, int idx );
+static void sl_psort_scatter( void* arg, int idx );
+static void sl_psort_bucket( void* arg, int idx );
 static sl_t sl_concatenate_base( sl_p s1, char* s2, sl_size_t len1 );
-static sl_t sl_insert_base( sl_p s1, int pos, char* s2, sl_size_t len1 );
+static sl_t sl_insert_base( sl_p s1, sl_pos_t pos, char* s2, sl_size_t len1 );
 static int sl_divide_base( sl_t ss, char c, int size, char** div );
-static int sl_segment_base( sl_t ss, char* sc, int size, char** div );
+static int sl_segment_base( sl_t ss, sl_pattern_p pat, int size, char** div );
+static int sl_segment_alloc( sl_t ss, sl_pattern_p pat, int size, char*** div );
+static sl_t sl_map_base( sl_p sp, sl_pattern_p pat, char* t );
+static sl_pos_t sl_find_base( const char* hay, size_t hlen, const char* ndl, size_t nlen );
+static sl_pos_t sl_pattern_base( sl_pattern_p pat, const char* hay, size_t hlen );
+static sl_pos_t sl_rchr_base( const char* hay, size_t hlen, char c );
+static void sl_index_put( sl_pos_t** idx, sl_size_t* size, int grow, sl_size_t cnt, sl_pos_t pos );
+static sl_ac_node_p sl_ac_build( char** pats, size_t* plen, sl_size_t n );
+static int32_t sl_ac_child( sl_ac_node_p ac, int32_t node, unsigned char c );
+
+static sl_rope_node_p sl_rope_leaf( const char* str, size_t len, uint32_t prio );
+static void sl_rope_update( sl_rope_node_p t );
+static sl_rope_node_p sl_rope_locate( sl_rope_node_p t, size_t pos, int at, size_t* off, int64_t delta );
+static void sl_rope_split( sl_rope_node_p t, size_t pos, sl_rope_node_p* a, sl_rope_node_p* b );
+static sl_rope_node_p sl_rope_merge( sl_rope_node_p a, sl_rope_node_p b );
+static void sl_rope_copy( sl_rope_node_p t, size_t pos, size_t len, char* dst );
+static void sl_rope_free( sl_rope_node_p t );
+static uint32_t sl_rope_rand( sl_rope_t r );
+
+static uint32_t sl_hash_base( const char* str, size_t len );
+static void sl_map_alloc( sl_map_p m, size_t cap );
+static void sl_map_rehash( sl_map_p m, size_t cap );
+static uint32_t sl_map_match( const uint8_t* ctrl, uint8_t v );
+static uint32_t sl_map_match_free( const uint8_t* ctrl );
+static void sl_map_set_ctrl( sl_map_p m, size_t i, uint8_t v );
+static size_t sl_map_find( sl_map_p m, const char* key, sl_size_t len, uint32_t h );
+static void sl_map_add( sl_map_p m, sl_t key, void* val );
+static sl_t sl_intern_base( sl_intern_t t, const char* str, sl_size_t len );
+static size_t sl_map_free_slot( sl_map_p m, uint32_t h );
+
+static sl_frag_s* sl_builder_frag( sl_builder_t* b );
+static char* sl_builder_data( sl_builder_t* b, sl_size_t len );
+static void sl_builder_copy( sl_builder_t* b, char* dst );
+
+static char* sl_fmt_parse( char* c, sl_fmt_spec_s* spec );
+static void sl_fmt_fetch( sl_fmt_spec_s* spec, va_list* ap, sl_fmt_arg_s* arg );
+static sl_size_t sl_fmt_put( sl_fmt_spec_s* spec, sl_fmt_arg_s* arg, char* wp );
+static sl_size_t sl_fmt_conv( sl_fmt_spec_s* spec, va_list* ap, char* wp );
+static sl_size_t sl_dbl_to_str( double d, sl_fmt_spec_s* spec, char* str );
+static void sl_big_set( sl_big_p b, uint64_t u64 );
+static void sl_big_shl( sl_big_p b, int n );
+static void sl_big_mul( sl_big_p b, uint32_t m );
+static void sl_big_pow10( sl_big_p b, int n );
+static int sl_big_cmp( sl_big_p a, sl_big_p b );
+static int sl_big_sum_cmp( sl_big_p a, sl_big_p b, sl_big_p c );
+static int sl_big_divmod( sl_big_p r, sl_big_p s );
+static int sl_dtoa_setup( double d, sl_big_p r, sl_big_p s, sl_big_p mp, sl_big_p mm, int* ok );
+static int sl_dtoa_shortest( double d, char* dig, int* kp );
+static int sl_dtoa_fixed( double d, int prec, char* dig, int* kp );
 
 static sl_size_t sl_u64_str_len( uint64_t u64 );
 static void sl_u64_to_str( uint64_t u64, char* str );
+static void sl_u64_to_hex( uint64_t u64, char* str, sl_size_t len, int upper );
 static sl_size_t sl_i64_str_len( int64_t i64 );
 static void sl_i64_to_str( int64_t i64, char* str );
 
@@ -68,8 +584,9 @@ static void sl_i64_to_str( int64_t i64, char* str );
 sl_t sl_new( sl_size_t size )
 {
     sl_base_p s;
-    s = (sl_base_p)sl_malloc( sl_malsize( size ) );
-    s->res = size;
+    if ( size > sl_size_max )
+        return NULL;
+    s = sl_heap_alloc( size );
     s->len = 0;
     s->str[ 0 ] = 0;
     return sl_str( s );
@@ -78,17 +595,157 @@ sl_t sl_new( sl_size_t size )
 
 sl_t sl_use( void* mem, sl_size_t size )
 {
-    sl_base_p s = mem;
-    s->res = size - sizeof( sl_s );
+    sl_ext_p x = mem;
+
+    /* Headers and at least the terminating null must fit. */
+    if ( size < sizeof( sl_ext_s ) + sizeof( sl_s ) + 1
+         || ( (uintptr_t)mem & ( _Alignof( sl_ext_s ) - 1 ) ) )
+        return NULL;
+
+    size -= sizeof( sl_ext_s ) + sizeof( sl_s );
+    if ( size > sl_size_max )
+        size = sl_size_max;
+
+    x->owner = NULL;
+    x->kind = SL_KIND_USE;
+    x->hash = 0;
+
+    sl_base_p s = (sl_base_p)( x + 1 );
+    s->res = size | SL_EXT_FLAG;
+    s->len = 0;
+    s->str[ 0 ] = 0;
+    return sl_str( s );
+}
+
+
+sl_t sl_new_hashable( sl_size_t size )
+{
+    if ( size > sl_size_max )
+        return NULL;
+
+    sl_ext_p x = sl_malloc( sizeof( sl_ext_s ) + sl_malsize( size ) );
+    x->owner = NULL;
+    x->kind = SL_KIND_HEAP;
+    x->hash = 0;
+
+    sl_base_p s = (sl_base_p)( x + 1 );
+    s->res = size | SL_EXT_FLAG;
+    s->len = 0;
+    s->str[ 0 ] = 0;
+    return sl_str( s );
+}
+
+
+sl_t sl_new_shareable( sl_size_t size )
+{
+    if ( size > sl_size_max )
+        return NULL;
+
+    sl_ext_p x = sl_malloc( sizeof( sl_ext_s ) + sl_malsize( size ) );
+    x->refs = 1;
+    x->kind = SL_KIND_SHARED;
+    x->hash = 0;
+
+    sl_base_p s = (sl_base_p)( x + 1 );
+    s->res = size | SL_EXT_FLAG;
     s->len = 0;
     s->str[ 0 ] = 0;
     return sl_str( s );
 }
 
 
+sl_t sl_share( sl_t ss )
+{
+    sl_base_p s = sl_base( ss );
+    sl_ext_p  x;
+
+    if ( sl_is_ext( s ) && sl_ext( s )->kind == SL_KIND_SHARED ) {
+        __atomic_add_fetch( &sl_ext( s )->refs, 1, __ATOMIC_RELAXED );
+        return ss;
+    }
+
+    x = sl_malloc( sizeof( sl_ext_s ) + sl_malsize( s->len + 1 ) );
+    x->refs = 1;
+    x->kind = SL_KIND_SHARED;
+    x->hash = 0;
+
+    sl_base_p n = (sl_base_p)( x + 1 );
+    n->res = ( s->len + 1 ) | SL_EXT_FLAG;
+    n->len = s->len;
+    memcpy( n->str, ss, s->len + 1 );
+    return sl_str( n );
+}
+
+
+sl_t sl_new_in( sl_arena_t arena, sl_size_t size )
+{
+    sl_base_p s;
+    if ( size > sl_size_max )
+        return NULL;
+    s = sl_arena_alloc( arena, size );
+    return sl_str( s );
+}
+
+
+sl_t sl_from_str_in( sl_arena_t arena, char* cs )
+{
+    sl_size_t len = sc_len1( cs );
+    sl_t       ss = sl_new_in( arena, len );
+    if ( ss == NULL )
+        return NULL;
+    memcpy( ss, cs, len );
+    sl_len( ss ) = len - 1;
+    return ss;
+}
+
+
+sl_arena_t sl_arena_new( size_t size )
+{
+    sl_arena_p a;
+    a = (sl_arena_p)sl_malloc( sizeof( struct sl_arena_s ) );
+    a->head = NULL;
+    a->cur = NULL;
+    a->last = NULL;
+    if ( size == 0 )
+        a->size = SL_ARENA_CHUNK;
+    else
+        a->size = size;
+    return a;
+}
+
+
+void sl_arena_reset( sl_arena_t arena )
+{
+    for ( sl_chunk_p c = arena->head; c; c = c->next )
+        c->used = 0;
+    arena->cur = arena->head;
+    arena->last = NULL;
+}
+
+
+sl_arena_t sl_arena_del( sl_arena_t* ap )
+{
+    sl_chunk_p c, n;
+
+    c = ( *ap )->head;
+    while ( c ) {
+        n = c->next;
+        sl_free( c );
+        c = n;
+    }
+    sl_free( *ap );
+    *ap = NULL;
+    return NULL;
+}
+
+
 sl_t sl_del( sl_p sp )
 {
-    sl_free( sl_base( *sp ) );
+    sl_base_p s = sl_base( *sp );
+    if ( sl_is_ext( s ) )
+        sl_ext_free( s );
+    else
+        sl_heap_free( s );
     *sp = 0;
     return NULL;
 }
@@ -96,11 +753,16 @@ sl_t sl_del( sl_p sp )
 
 sl_t sl_reserve( sl_p sp, sl_size_t size )
 {
+    if ( size > sl_size_max )
+        return NULL;
+
     if ( sl_res( *sp ) < size ) {
         sl_base_p s;
         s = sl_base( *sp );
-        s = (sl_base_p)sl_realloc( s, sl_malsize( size ) );
-        s->res = size;
+        if ( sl_is_ext( s ) )
+            s = sl_ext_resize( s, size );
+        else
+            s = sl_heap_resize( s, size );
         *sp = sl_str( s );
     }
 
@@ -108,6 +770,42 @@ sl_t sl_reserve( sl_p sp, sl_size_t size )
 }
 
 
+sl_t sl_reserve_with( sl_p sp, sl_size_t size, sl_grow_t grow )
+{
+    if ( sl_res( *sp ) < size )
+        return sl_reserve( sp, sl_grow_size( sl_res( *sp ), size, grow ) );
+
+    return *sp;
+}
+
+
+void sl_cfg_growth( sl_grow_t grow, sl_size_t factor )
+{
+    sl_grow_policy = grow;
+    sl_grow_factor = factor;
+}
+
+
+void sl_cfg_pool( int enable )
+{
+    sl_pool_on = enable;
+}
+
+
+void sl_pool_stat( sl_pool_stat_s* stat )
+{
+    *stat = sl_pool.stat;
+    for ( int cls = 0; cls < SL_POOL_CLASSES; cls++ )
+        stat->used[ cls ] = __atomic_load_n( &sl_pool_used[ cls ], __ATOMIC_RELAXED );
+}
+
+
+void sl_pool_trim( void )
+{
+    sl_pool_release( &sl_pool );
+}
+
+
 sl_t sl_compact( sl_p sp )
 {
     sl_size_t len = sl_len1( *sp );
@@ -115,8 +813,10 @@ sl_t sl_compact( sl_p sp )
     if ( sl_res( *sp ) > len ) {
         sl_base_p s;
         s = sl_base( *sp );
-        s = (sl_base_p)sl_realloc( s, sl_malsize( len ) );
-        s->res = len;
+        if ( sl_is_ext( s ) )
+            s = sl_ext_resize( s, len );
+        else
+            s = sl_heap_resize( s, len );
         *sp = sl_str( s );
     }
 
@@ -139,7 +839,9 @@ sl_t sl_copy_c( sl_p s1, char* s2 )
 sl_t sl_fill_with_char( sl_p sp, char c, sl_size_t cnt )
 {
     ssize_t len = sl_len( *sp );
-    sl_reserve( sp, len + cnt + 1 );
+    sl_unshare( sp );
+    if ( sl_grow( sp, (uint64_t)len + cnt + 1 ) == NULL )
+        return NULL;
     char* p = &( ( *sp )[ len ] );
     for ( sl_size_t i = 0; i < cnt; i++, p++ )
         *p = c;
@@ -154,7 +856,9 @@ sl_t sl_multiple_str_append( sl_p sp, char* cs, sl_size_t cnt )
     ssize_t len = sl_len( *sp );
     ssize_t clen = sc_len( cs );
 
-    sl_reserve( sp, len + cnt * clen + 1 );
+    sl_unshare( sp );
+    if ( sl_grow( sp, (uint64_t)len + (uint64_t)cnt * clen + 1 ) == NULL )
+        return NULL;
     char* p = &( ( *sp )[ len ] );
     for ( sl_size_t i = 0; i < cnt; i++ ) {
         strncpy( p, cs, clen );
@@ -195,6 +899,7 @@ sl_t sl_replicate( sl_t ss )
 
 sl_t sl_clear( sl_t ss )
 {
+    sl_unhash( ss );
     sl_len( ss ) = 0;
     *ss = 0;
     return ss;
@@ -205,6 +910,8 @@ sl_t sl_from_str_c( char* cs )
 {
     sl_size_t len = sc_len1( cs );
     sl_t       ss = sl_new( len );
+    if ( ss == NULL )
+        return NULL;
     strncpy( ss, cs, len );
     sl_len( ss ) = len - 1;
     return ss;
@@ -219,6 +926,8 @@ sl_t sl_from_str_with_size_c( char* cs, sl_size_t size )
         ss = sl_new( size );
     else
         ss = sl_new( len );
+    if ( ss == NULL )
+        return NULL;
     sl_copy_c( &ss, cs );
     return ss;
 }
@@ -259,72 +968,203 @@ int sl_compare( sl_t s1, sl_t s2 )
 
 int sl_is_different( sl_t s1, sl_t s2 )
 {
-    if ( sl_len( s1 ) != sl_len( s2 ) )
-        return 1;
-    else if ( strcmp( s1, s2 ) == 0 )
-        return 0;
-    else
-        return 1;
+    return !sl_equal( s1, s2 );
 }
 
 
-void sl_sort( sl_v sa, sl_size_t len )
+int sl_compare_bin( sl_t s1, sl_t s2 )
 {
-    qsort( sa, len, sizeof( char* ), sl_compare_base );
+    return sl_compare_bin_base( s1, sl_len( s1 ), s2, sl_len( s2 ) );
 }
 
 
-sl_t sl_concatenate( sl_p s1, sl_t s2 )
+int sl_equal( sl_t s1, sl_t s2 )
 {
-    return sl_concatenate_base( s1, s2, sl_len1( s2 ) );
+    sl_size_t n = sl_len( s1 );
+    uint64_t  a, b;
+
+    if ( n != sl_len( s2 ) )
+        return 0;
+    else if ( s1 == s2 )
+        return 1;
+
+    if ( sl_is_ext( sl_base( s1 ) ) && sl_is_ext( sl_base( s2 ) ) ) {
+        /* Known hashes must match. */
+        uint32_t h1 = __atomic_load_n( &sl_ext( sl_base( s1 ) )->hash, __ATOMIC_RELAXED );
+        uint32_t h2 = __atomic_load_n( &sl_ext( sl_base( s2 ) )->hash, __ATOMIC_RELAXED );
+        if ( h1 && h2 && h1 != h2 )
+            return 0;
+    }
+
+    if ( n >= 8 && n <= 16 ) {
+        /* Overlapping words. */
+        memcpy( &a, s1, 8 );
+        memcpy( &b, s2, 8 );
+        if ( a != b )
+            return 0;
+        memcpy( &a, s1 + n - 8, 8 );
+        memcpy( &b, s2 + n - 8, 8 );
+        return a == b;
+    }
+
+    return memcmp( s1, s2, n ) == 0;
 }
 
 
-sl_t sl_concatenate_c( sl_p s1, char* s2 )
+uint32_t sl_hash( sl_t ss )
 {
-    return sl_concatenate_base( s1, s2, sc_len1( s2 ) );
+    sl_base_p s = sl_base( ss );
+    uint32_t  h;
+
+    /*
+     * Shared SL hash may be cached by several threads at once. They
+     * store the same value, and access is atomic.
+     */
+    if ( sl_is_ext( s ) && ( h = __atomic_load_n( &sl_ext( s )->hash, __ATOMIC_RELAXED ) ) )
+        return h;
+
+    h = sl_hash_base( ss, s->len );
+    if ( sl_is_ext( s ) )
+        __atomic_store_n( &sl_ext( s )->hash, h, __ATOMIC_RELAXED );
+
+    return h;
 }
 
 
-sl_t sl_push_char_to( sl_p sp, int pos, char c )
+void sl_hash_reset( sl_t ss )
 {
-    pos = sl_norm_idx( *sp, pos );
-    sl_base_p s = sl_base( *sp );
-    sl_reserve( sp, sl_len( *sp ) + 1 );
-    if ( (sl_size_t)pos != s->len )
-        memmove( &s->str[ pos + 1 ], &s->str[ pos ], s->len - pos );
-    s->str[ pos ] = c;
-    s->len++;
-    s->str[ s->len ] = 0;
-    return *sp;
+    sl_unhash( ss );
 }
 
 
-sl_t sl_pop_char_from( sl_t ss, int pos )
+void sl_sort( sl_v sa, sl_size_t len )
 {
-    pos = sl_norm_idx( ss, pos );
-    sl_base_p s = sl_base( ss );
-    if ( (sl_size_t)pos != s->len ) {
-        memmove( &s->str[ pos ], &s->str[ pos + 1 ], s->len - pos );
-        s->len--;
-    }
-    return ss;
+    sl_sort_base( sa, len, SL_SORT_LEN );
 }
 
 
-sl_t sl_limit_to_pos( sl_t ss, int pos )
+void sl_sort_with( sl_v sa, sl_size_t len, int flags )
 {
-    sl_base_p s = sl_base( ss );
-    s->str[ pos ] = 0;
-    s->len = pos;
-    return ss;
+    sl_sort_base( sa, len, flags | SL_SORT_LEN );
 }
 
 
-sl_t sl_cut( sl_t ss, int cnt )
+void sl_sort_cstr( char** sa, sl_size_t len, int flags )
 {
-    int pos;
-    sl_base_p s = sl_base( ss );
+    sl_sort_base( sa, len, flags & ~( SL_SORT_LEN | SL_SORT_BINARY ) );
+}
+
+
+void sl_sort_parallel( sl_v sa, sl_size_t len, int nthreads )
+{
+    /*
+     * Sample sort: splitters are selected from a sample, strings are
+     * distributed to buckets by splitters, and each thread sorts one
+     * bucket. Strings equal to a splitter have their own bucket,
+     * which needs no sorting. Each phase is run in parallel.
+     */
+
+    sl_psort_s  ps;
+    char**      sample;
+    char*       split[ SL_SORT_THREADS_MAX ];
+    sl_par_fn_t phase[ 3 ] = { sl_psort_classify, sl_psort_scatter, sl_psort_bucket };
+    uint64_t    seed = 1;
+    int         ns;
+
+    if ( nthreads > SL_SORT_THREADS_MAX )
+        nthreads = SL_SORT_THREADS_MAX;
+
+    if ( nthreads <= 1 || len < SL_SORT_PARALLEL_MIN ) {
+        sl_sort( sa, len );
+        return;
+    }
+
+    ns = nthreads * SL_SORT_SAMPLES;
+    sample = sl_malloc( ns * sizeof( char* ) );
+    for ( int i = 0; i < ns; i++ ) {
+        /* 64-bit LCG, and modulo to reach all of a SL_WIDE array. */
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        sample[ i ] = sa[ ( seed >> 16 ) % len ];
+    }
+    sl_sort_cstr( sample, ns, 0 );
+    for ( int i = 1; i < nthreads; i++ )
+        split[ i - 1 ] = sample[ i * SL_SORT_SAMPLES ];
+    sl_free( sample );
+
+    ps.sa = sa;
+    ps.len = len;
+    ps.nthr = nthreads;
+    ps.flags = SL_SORT_LEN;
+    ps.split = split;
+    ps.nbkt = 2 * nthreads - 1;
+    ps.out = sl_malloc( len * sizeof( char* ) );
+    ps.bkt = sl_malloc( len * sizeof( uint16_t ) );
+    ps.cnt = sl_malloc( nthreads * ps.nbkt * sizeof( size_t ) );
+
+    sl_par_run( nthreads, phase, 3, &ps );
+
+    sl_free( ps.out );
+    sl_free( ps.bkt );
+    sl_free( ps.cnt );
+}
+
+
+sl_t sl_concatenate( sl_p s1, sl_t s2 )
+{
+    return sl_concatenate_base( s1, s2, sl_len1( s2 ) );
+}
+
+
+sl_t sl_concatenate_c( sl_p s1, char* s2 )
+{
+    return sl_concatenate_base( s1, s2, sc_len1( s2 ) );
+}
+
+
+sl_t sl_push_char_to( sl_p sp, sl_pos_t pos, char c )
+{
+    sl_unshare( sp );
+    pos = sl_norm_idx( sl_len( *sp ), pos );
+    if ( sl_grow( sp, (uint64_t)sl_len( *sp ) + 2 ) == NULL )
+        return NULL;
+    sl_base_p s = sl_base( *sp );
+    if ( (sl_size_t)pos != s->len )
+        memmove( &s->str[ pos + 1 ], &s->str[ pos ], s->len - pos );
+    s->str[ pos ] = c;
+    s->len++;
+    s->str[ s->len ] = 0;
+    return *sp;
+}
+
+
+sl_t sl_pop_char_from( sl_t ss, sl_pos_t pos )
+{
+    sl_unhash( ss );
+    pos = sl_norm_idx( sl_len( ss ), pos );
+    sl_base_p s = sl_base( ss );
+    if ( (sl_size_t)pos != s->len ) {
+        memmove( &s->str[ pos ], &s->str[ pos + 1 ], s->len - pos );
+        s->len--;
+    }
+    return ss;
+}
+
+
+sl_t sl_limit_to_pos( sl_t ss, sl_pos_t pos )
+{
+    sl_base_p s = sl_base( ss );
+    sl_unhash( ss );
+    s->str[ pos ] = 0;
+    s->len = pos;
+    return ss;
+}
+
+
+sl_t sl_cut( sl_t ss, sl_pos_t cnt )
+{
+    sl_size_t pos;
+    sl_base_p s = sl_base( ss );
+    sl_unhash( ss );
     if ( cnt >= 0 ) {
         pos = s->len - cnt;
         s->str[ pos ] = 0;
@@ -341,19 +1181,21 @@ sl_t sl_cut( sl_t ss, int cnt )
 }
 
 
-sl_t sl_select_slice( sl_t ss, int a, int b )
+sl_t sl_select_slice( sl_t ss, sl_pos_t a, sl_pos_t b )
 {
     sl_size_t an, bn;
 
+    sl_unhash( ss );
+
     /* Normalize a. */
-    an = sl_norm_idx( ss, a );
+    an = sl_norm_idx( sl_len( ss ), a );
 
     /* Normalize b. */
-    bn = sl_norm_idx( ss, b );
+    bn = sl_norm_idx( sl_len( ss ), b );
 
     /* Reorder. */
     if ( bn < an ) {
-        int t;
+        sl_size_t t;
         t = an;
         an = bn;
         bn = t;
@@ -368,13 +1210,13 @@ sl_t sl_select_slice( sl_t ss, int a, int b )
 }
 
 
-sl_t sl_insert_to( sl_p s1, int pos, sl_t s2 )
+sl_t sl_insert_to( sl_p s1, sl_pos_t pos, sl_t s2 )
 {
     return sl_insert_base( s1, pos, s2, sl_len1( s2 ) );
 }
 
 
-sl_t sl_insert_to_c( sl_p s1, int pos, char* s2 )
+sl_t sl_insert_to_c( sl_p s1, sl_pos_t pos, char* s2 )
 {
     return sl_insert_base( s1, pos, s2, sc_len1( s2 ) );
 }
@@ -395,21 +1237,61 @@ sl_t sl_format( sl_p sp, char* fmt, ... )
 
 sl_t sl_va_format( sl_p sp, char* fmt, va_list ap )
 {
-    va_list coap;
+    return sl_va_format_hint( sp, 0, fmt, ap );
+}
+
+
+sl_t sl_format_hint( sl_p sp, sl_size_t hint, char* fmt, ... )
+{
+    sl_t    ret;
+    va_list ap;
+
+    va_start( ap, fmt );
+    ret = sl_va_format_hint( sp, hint, fmt, ap );
+    va_end( ap );
+
+    return ret;
+}
+
+
+sl_t sl_va_format_hint( sl_p sp, sl_size_t hint, char* fmt, va_list ap )
+{
+    /*
+     * Format directly to spare storage. Grow and format again only if
+     * the output did not fit.
+     */
+
+    va_list   coap;
+    sl_size_t avail;
+    int       size;
+
+    sl_unshare( sp );
 
     /* Copy ap to coap for second va-call. */
     va_copy( coap, ap );
 
-    int size;
-    size = vsnprintf( NULL, 0, fmt, ap );
+    if ( sl_res( *sp ) - sl_len( *sp ) < (uint64_t)hint + 1
+         && sl_grow( sp, (uint64_t)sl_len1( *sp ) + hint ) == NULL ) {
+        va_end( coap );
+        return NULL;
+    }
 
-    if ( size < 0 )
-        return NULL; // GCOV_EXCL_LINE
+    avail = sl_res( *sp ) - sl_len( *sp );
+    size = vsnprintf( sl_end( *sp ), avail, fmt, ap );
 
-    size++;
-    sl_reserve( sp, sl_len( *sp ) + size );
+    if ( size < 0 ) {
+        va_end( coap ); // GCOV_EXCL_LINE
+        return NULL;    // GCOV_EXCL_LINE
+    }
 
-    size = vsnprintf( sl_end( *sp ), size, fmt, coap );
+    if ( (sl_size_t)size >= avail ) {
+        if ( sl_grow( sp, (uint64_t)sl_len1( *sp ) + size ) == NULL ) {
+            ( *sp )[ sl_len( *sp ) ] = 0;
+            va_end( coap );
+            return NULL;
+        }
+        vsnprintf( sl_end( *sp ), size + 1, fmt, coap );
+    }
     va_end( coap );
 
     sl_len( *sp ) += size;
@@ -433,325 +1315,578 @@ sl_t sl_format_quick( sl_p sp, char* fmt, ... )
 
 sl_t sl_va_format_quick( sl_p sp, char* fmt, va_list ap )
 {
-    va_list coap;
+    /*
+     * Format is scanned twice. First scan calculates the exact size,
+     * SL is reserved once, and second scan writes the conversions.
+     */
 
-    /* Copy ap to coap for second va-call. */
-    va_copy( coap, ap );
+    va_list       ap1, ap2;
+    sl_fmt_spec_s spec;
+    sl_size_t     size = 0;
+    char*         c;
+    char*         p;
+
+    sl_unshare( sp );
 
-    int size = 0;
+    va_copy( ap1, ap );
+    va_copy( ap2, ap );
 
 
     /* ------------------------------------------------------------
      * Calculate string size.
      */
 
-    char*    c;
-    char*    ts;
-    int64_t  i64;
-    uint64_t u64;
-
     c = fmt;
-
     while ( *c ) {
+        if ( *c == '%' ) {
+            c = sl_fmt_parse( c + 1, &spec );
+            size += sl_fmt_conv( &spec, &ap1, NULL );
+        } else {
+            p = strchr( c, '%' );
+            if ( p == NULL )
+                p = c + strlen( c );
+            size += p - c;
+            c = p;
+        }
+    }
+    va_end( ap1 );
 
-        switch ( *c ) {
-
-            case '%': {
-                c++;
-
-                switch ( *c ) {
-
-                    case 's': {
-                        ts = va_arg( ap, char* );
-                        size += strlen( ts );
-                        break;
-                    }
+    if ( sl_grow( sp, (uint64_t)sl_len1( *sp ) + size ) == NULL )
+        return NULL;
 
-                    case 'S': {
-                        ts = va_arg( ap, char* );
-                        size += sl_len( ts );
-                        break;
-                    }
 
-                    case 'i': {
-                        i64 = va_arg( ap, int );
-                        size += sl_i64_str_len( i64 );
-                        break;
-                    }
+    /* ------------------------------------------------------------
+     * Expand format string.
+     */
 
-                    case 'I': {
-                        i64 = va_arg( ap, int64_t );
-                        size += sl_i64_str_len( i64 );
-                        break;
-                    }
+    char* wp = sl_end( *sp );
+    sl_len( *sp ) += size;
 
-                    case 'u': {
-                        u64 = va_arg( ap, unsigned int );
-                        size += sl_u64_str_len( u64 );
-                        break;
-                    }
+    c = fmt;
+    while ( *c ) {
+        if ( *c == '%' ) {
+            c = sl_fmt_parse( c + 1, &spec );
+            wp += sl_fmt_conv( &spec, &ap2, wp );
+        } else {
+            p = strchr( c, '%' );
+            if ( p == NULL )
+                p = c + strlen( c );
+            memcpy( wp, c, p - c );
+            wp += p - c;
+            c = p;
+        }
+    }
+    va_end( ap2 );
 
-                    case 'U': {
-                        u64 = va_arg( ap, uint64_t );
-                        size += sl_u64_str_len( u64 );
-                        break;
-                    }
+    *wp = 0;
 
-                    case 'c': {
-                        size++;
-                        break;
-                    }
+    return *sp;
+}
 
-                    case '%': {
-                        size++;
-                        break;
-                    }
 
-                    default: {
-                        size++;
-                        break;
-                    }
-                }
+sl_fmt_t sl_fmt_compile( char* fmt )
+{
+    sl_fmt_p       f;
+    sl_fmt_item_s* it;
+    sl_fmt_spec_s  spec;
+    sl_size_t      max = 1;
+    sl_size_t      flen = sc_len( fmt );
+    char*          lp;
+    char*          c;
+    char*          p;
+
+    /* Each conversion may be surrounded by literals. */
+    for ( c = strchr( fmt, '%' ); c; c = strchr( c + 1, '%' ) )
+        max += 2;
+
+    f = sl_malloc( sizeof( struct sl_fmt_s ) + max * sizeof( sl_fmt_item_s ) + flen + 1 );
+    f->cnt = 0;
+    f->args = 0;
+    f->lit = 0;
+    lp = (char*)( f->item + max );
 
-                c++;
-                break;
+    c = fmt;
+    while ( *c ) {
+        if ( *c == '%' ) {
+            p = c + 1;
+            c = sl_fmt_parse( p, &spec );
+            if ( spec.width == 0 && ( spec.conv == 0 || !strchr( SL_FMT_CONVS, spec.conv ) ) ) {
+                /* Literal char, including '%'. */
+                p = c - ( spec.conv ? 1 : 0 );
+            } else {
+                it = &f->item[ f->cnt++ ];
+                it->spec = spec;
+                it->lit = NULL;
+                it->len = 0;
+                f->args++;
+                continue;
             }
+        } else {
+            p = strchr( c, '%' );
+            if ( p == NULL )
+                p = c + strlen( c );
+            sl_size_t n = p - c;
+            p = c;
+            c += n;
+        }
 
-            default: {
-                size++;
-                c++;
-                break;
-            }
+        /* Append to literal, "p" to "c". */
+        if ( f->cnt == 0 || f->item[ f->cnt - 1 ].spec.conv != 0 ) {
+            it = &f->item[ f->cnt++ ];
+            it->spec.conv = 0;
+            it->lit = lp;
+            it->len = 0;
         }
+        it = &f->item[ f->cnt - 1 ];
+        memcpy( lp, p, c - p );
+        lp += c - p;
+        it->len += c - p;
+        f->lit += c - p;
     }
 
-    va_end( ap );
-
-    sl_reserve( sp, sl_len1( *sp ) + size );
-
-
-    /* ------------------------------------------------------------
-     * Expand format string.
-     */
-
-    char* wp = sl_end( *sp );
-
-    sl_len( *sp ) += size;
-    c = fmt;
+    return f;
+}
 
-    while ( *c ) {
 
-        switch ( *c ) {
+sl_fmt_t sl_fmt_del( sl_fmt_t* fp )
+{
+    sl_free( *fp );
+    *fp = NULL;
+    return NULL;
+}
 
-            case '%': {
-                c++;
 
-                switch ( *c ) {
+sl_t sl_fmt_apply( sl_p sp, sl_fmt_t fmt, ... )
+{
+    sl_t    ret;
+    va_list ap;
 
-                    case 's':
-                    case 'S': {
-                        ts = va_arg( coap, char* );
-                        if ( *c == 's' )
-                            size = strlen( ts );
-                        else
-                            size = sl_len( ts );
-                        strncpy( wp, ts, size );
-                        wp += size;
-                        break;
-                    }
+    va_start( ap, fmt );
+    ret = sl_va_fmt_apply( sp, fmt, ap );
+    va_end( ap );
 
-                    case 'i':
-                    case 'I': {
-                        if ( *c == 'i' )
-                            i64 = va_arg( coap, int );
-                        else
-                            i64 = va_arg( coap, int64_t );
-                        size = sl_i64_str_len( i64 );
-                        sl_i64_to_str( i64, wp );
-                        wp += size;
-                        break;
-                    }
+    return ret;
+}
 
-                    case 'u':
-                    case 'U': {
-                        if ( *c == 'u' )
-                            u64 = va_arg( coap, unsigned int );
-                        else
-                            u64 = va_arg( coap, uint64_t );
-                        size = sl_u64_str_len( u64 );
-                        sl_u64_to_str( u64, wp );
-                        wp += size;
-                        break;
-                    }
 
-                    case 'c': {
-                        char ch;
-                        ch = (char)va_arg( coap, int );
-                        *wp++ = ch;
-                        break;
-                    }
+sl_t sl_va_fmt_apply( sl_p sp, sl_fmt_t fmt, va_list ap )
+{
+    /*
+     * Arguments are fetched once and conversion sizes are calculated
+     * from them. Doubles are converted to scratch while it has room,
+     * so they are not converted twice.
+     */
 
-                    case '%': {
-                        *wp++ = '%';
-                        break;
-                    }
+    sl_fmt_arg_s   local[ SL_FMT_ARGS ];
+    sl_fmt_arg_s*  args = local;
+    sl_fmt_arg_s*  arg;
+    sl_fmt_item_s* it;
+    char           scratch[ SL_FMT_SCRATCH ];
+    sl_size_t      soff = 0;
+    sl_size_t      size = fmt->lit;
+    va_list        ap1;
+
+    sl_unshare( sp );
+
+    if ( fmt->args > SL_FMT_ARGS )
+        args = sl_malloc( fmt->args * sizeof( sl_fmt_arg_s ) );
+
+    va_copy( ap1, ap );
+    arg = args;
+    for ( sl_size_t i = 0; i < fmt->cnt; i++ ) {
+        it = &fmt->item[ i ];
+        if ( it->spec.conv == 0 )
+            continue;
+        sl_fmt_fetch( &it->spec, &ap1, arg );
+        if ( ( it->spec.conv == 'f' || it->spec.conv == 'g' )
+             && SL_FMT_SCRATCH - soff >= SL_FMT_BUF ) {
+            arg->text = scratch + soff;
+            arg->tlen = sl_dbl_to_str( arg->v.d, &it->spec, scratch + soff );
+            soff += arg->tlen;
+        }
+        size += sl_fmt_put( &it->spec, arg, NULL );
+        arg++;
+    }
+    va_end( ap1 );
 
-                    default: {
-                        *wp++ = *c;
-                        break;
-                    }
-                }
+    if ( sl_grow( sp, (uint64_t)sl_len1( *sp ) + size ) == NULL ) {
+        if ( args != local )
+            sl_free( args );
+        return NULL;
+    }
 
-                c++;
-                break;
-            }
+    char* wp = sl_end( *sp );
+    sl_len( *sp ) += size;
 
-            default: {
-                *wp++ = *c++;
-                break;
-            }
+    arg = args;
+    for ( sl_size_t i = 0; i < fmt->cnt; i++ ) {
+        it = &fmt->item[ i ];
+        if ( it->spec.conv == 0 ) {
+            memcpy( wp, it->lit, it->len );
+            wp += it->len;
+        } else {
+            wp += sl_fmt_put( &it->spec, arg++, wp );
         }
     }
-    va_end( coap );
 
     *wp = 0;
 
+    if ( args != local )
+        sl_free( args );
+
     return *sp;
 }
 
 
-int sl_invert_pos( sl_t ss, int pos )
+sl_pos_t sl_invert_pos( sl_t ss, sl_pos_t pos )
 {
     if ( pos > 0 )
-        return -1 * ( sl_len( ss ) - pos );
+        return pos - (sl_pos_t)sl_len( ss );
     else
-        return sl_len( ss ) + pos;
+        return (sl_pos_t)sl_len( ss ) + pos;
 }
 
 
-int sl_find_char_right( sl_t ss, char c, sl_size_t pos )
+sl_pos_t sl_find_char_right( sl_t ss, char c, sl_size_t pos )
 {
-    while ( pos < sl_len( ss ) && ss[ pos ] != c )
-        pos++;
-
-    if ( pos == sl_len( ss ) )
-        return -1;
-    else
-        return pos;
+    return sl_view_find_char( sl_view( ss ), c, pos );
 }
 
 
-int sl_find_char_left( sl_t ss, char c, sl_size_t pos )
+sl_pos_t sl_find_char_left( sl_t ss, char c, sl_size_t pos )
 {
-    while ( pos > 0 && ss[ pos ] != c )
-        pos--;
+    /* Terminator position is included, as before. */
+    if ( pos > sl_len( ss ) )
+        pos = sl_len( ss );
 
-    if ( pos == 0 && ss[ pos ] != c )
-        return -1;
-    else
-        return pos;
+    return sl_rchr_base( ss, pos + 1, c );
 }
 
 
-int sl_find_index( sl_t s1, char* s2 )
+sl_size_t sl_find_char_all( sl_t ss, char c, sl_pos_t** idx, sl_size_t size )
 {
-    if ( s2[ 0 ] == 0 )
-        return -1;
+    int         grow = ( *idx == NULL );
+    sl_size_t   cnt = 0;
+    size_t      i = 0;
+    size_t      len = sl_len( ss );
+    const char* p;
 
-    int i1 = 0;
-    int i2 = 0;
-    int i;
+    if ( grow )
+        size = 0;
 
-    while ( s1[ i1 ] ) {
-        i = i1;
-        if ( s1[ i ] == s2[ i2 ] ) {
-            while ( s1[ i ] == s2[ i2 ] && s2[ i2 ] ) {
-                i++;
-                i2++;
-            }
-            if ( s2[ i2 ] == 0 )
-                return i1;
+#if defined( __AVX2__ )
+
+    __m256i v32 = _mm256_set1_epi8( c );
+
+    for ( ; i + 32 <= len; i += 32 ) {
+        uint32_t mask = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8( v32, _mm256_loadu_si256( (const __m256i*)( ss + i ) ) ) );
+        while ( mask ) {
+            sl_index_put( idx, &size, grow, cnt++, i + __builtin_ctz( mask ) );
+            mask &= mask - 1;
         }
-        i1++;
     }
 
-    return -1;
+#endif
+
+#if defined( __SSE2__ )
+
+    __m128i v16 = _mm_set1_epi8( c );
+
+    for ( ; i + 16 <= len; i += 16 ) {
+        uint32_t mask =
+            _mm_movemask_epi8( _mm_cmpeq_epi8( v16, _mm_loadu_si128( (const __m128i*)( ss + i ) ) ) );
+        while ( mask ) {
+            sl_index_put( idx, &size, grow, cnt++, i + __builtin_ctz( mask ) );
+            mask &= mask - 1;
+        }
+    }
+
+#endif
+
+    while ( i < len && ( p = memchr( ss + i, c, len - i ) ) ) {
+        i = p - ss;
+        sl_index_put( idx, &size, grow, cnt++, i );
+        i++;
+    }
+
+    return cnt;
 }
 
 
-int sl_divide_with_char( sl_t ss, char c, int size, char*** div )
+sl_pos_t sl_find_index( sl_t s1, char* s2 )
 {
-    if ( size < 0 ) {
-        /* Just count size, don't replace chars. */
-        return sl_divide_base( ss, c, -1, NULL );
-    } else if ( *div ) {
-        /* Use pre-allocated storage. */
-        return sl_divide_base( ss, c, size, *div );
-    } else {
-        /* Calculate size and allocate storage. */
-        size = sl_divide_base( ss, c, -1, NULL );
-        *div = (char**)sl_malloc( size * sizeof( char* ) );
-        return sl_divide_base( ss, c, size, *div );
-    }
+    return sl_find_base( s1, sl_len( s1 ), s2, sc_len( s2 ) );
 }
 
 
-int sl_segment_with_str( sl_t ss, char* sc, int size, char*** div )
+sl_view_t sl_view( sl_t ss )
 {
-    if ( size < 0 ) {
-        /* Just count size, don't replace chars. */
-        return sl_segment_base( ss, sc, -1, NULL );
-    } else if ( *div ) {
-        /* Use pre-allocated storage. */
-        return sl_segment_base( ss, sc, size, *div );
-    } else {
-        /* Calculate size and allocate storage. */
-        size = sl_segment_base( ss, sc, -1, NULL );
-        *div = (char**)sl_malloc( size * sizeof( char* ) );
-        return sl_segment_base( ss, sc, size, *div );
-    }
+    sl_view_t v = { ss, sl_len( ss ) };
+    return v;
 }
 
 
-sl_t sl_glue_array( sl_v sa, sl_size_t size, char* glu )
+sl_view_t sl_view_c( const char* cs )
 {
-    int       len = 0;
-    sl_size_t i;
+    sl_view_t v = { cs, sc_len( (char*)cs ) };
+    return v;
+}
 
-    /* Calc sa len. */
-    i = 0;
-    while ( i < size )
-        len += strlen( sa[ i++ ] );
 
-    /* Add glu len. */
-    len += ( size - 1 ) * strlen( glu );
+sl_view_t sl_view_slice( sl_view_t v, sl_pos_t a, sl_pos_t b )
+{
+    sl_size_t an, bn;
 
-    sl_t ss;
-    ss = sl_new( len + 1 );
-    sl_len( ss ) = len;
+    an = sl_norm_idx( v.len, a );
+    bn = sl_norm_idx( v.len, b );
 
-    /* Build result. */
-    char* p = ss;
-    i = 0;
-    while ( i < size ) {
-        p = sl_copy_setup( p, sa[ i ] );
-        if ( i < ( size - 1 ) )
-            p = sl_copy_setup( p, glu );
-        i++;
+    /* Reorder. */
+    if ( bn < an ) {
+        sl_size_t t;
+        t = an;
+        an = bn;
+        bn = t;
     }
-    ss[ sl_len( ss ) ] = 0;
 
-    return ss;
+    v.ptr += an;
+    v.len = bn - an;
+
+    return v;
 }
 
 
-char* sl_tokenize( sl_t ss, char* delim, char** pos )
+sl_pos_t sl_view_find( sl_view_t v, sl_view_t ndl )
 {
-    if ( *pos == 0 ) {
-        /* First iteration. */
-        int idx;
-        idx = sl_find_index( ss, delim );
-        if ( idx < 0 )
+    return sl_find_base( v.ptr, v.len, ndl.ptr, ndl.len );
+}
+
+
+sl_pos_t sl_view_find_char( sl_view_t v, char c, sl_size_t pos )
+{
+    if ( pos >= v.len )
+        return -1;
+
+    const char* p = memchr( v.ptr + pos, c, v.len - pos );
+    return p ? p - v.ptr : -1;
+}
+
+
+int sl_view_compare( sl_view_t v1, sl_view_t v2 )
+{
+    return sl_compare_bin_base( v1.ptr, v1.len, v2.ptr, v2.len );
+}
+
+
+sl_t sl_from_view( sl_view_t v )
+{
+    if ( v.len >= sl_size_max )
+        return NULL;
+    sl_t ss = sl_new( v.len + 1 );
+    memcpy( ss, v.ptr, v.len );
+    ss[ v.len ] = 0;
+    sl_len( ss ) = v.len;
+    return ss;
+}
+
+
+void sl_builder_begin( sl_builder_t* b )
+{
+    b->frag = b->frag_buf;
+    b->cnt = 0;
+    b->size = SL_BUILDER_FRAGS;
+    b->data = b->data_buf;
+    b->dlen = 0;
+    b->dsize = SL_BUILDER_DATA;
+    b->len = 0;
+}
+
+
+void sl_builder_add( sl_builder_t* b, sl_t ss )
+{
+    sl_view_t v = { ss, sl_len( ss ) };
+    sl_builder_add_view( b, v );
+}
+
+
+void sl_builder_add_c( sl_builder_t* b, char* cs )
+{
+    sl_view_t v = { cs, sc_len( cs ) };
+    sl_builder_add_view( b, v );
+}
+
+
+void sl_builder_add_view( sl_builder_t* b, sl_view_t v )
+{
+    sl_frag_s* f = sl_builder_frag( b );
+    f->ptr = v.ptr;
+    f->len = v.len;
+    b->len += v.len;
+}
+
+
+void sl_builder_add_char( sl_builder_t* b, char c )
+{
+    *sl_builder_data( b, 1 ) = c;
+}
+
+
+void sl_builder_add_i64( sl_builder_t* b, int64_t i64 )
+{
+    sl_i64_to_str( i64, sl_builder_data( b, sl_i64_str_len( i64 ) ) );
+}
+
+
+void sl_builder_add_u64( sl_builder_t* b, uint64_t u64 )
+{
+    sl_u64_to_str( u64, sl_builder_data( b, sl_u64_str_len( u64 ) ) );
+}
+
+
+sl_size_t sl_builder_length( sl_builder_t* b )
+{
+    return b->len;
+}
+
+
+sl_t sl_builder_end( sl_builder_t* b, sl_p sp )
+{
+    char* tmp = NULL;
+
+    if ( *sp == NULL && ( *sp = sl_new( b->len + 1 ) ) == NULL )
+        return NULL;
+
+    sl_unshare( sp );
+
+    sl_size_t len = sl_len( *sp );
+
+    if ( sl_res( *sp ) < len + b->len + 1 ) {
+        /* Fragments from target SL must be saved before resize. */
+        for ( sl_size_t i = 0; i < b->cnt; i++ ) {
+            if ( b->frag[ i ].ptr && sl_within( *sp, b->frag[ i ].ptr ) ) {
+                tmp = sl_malloc( b->len );
+                sl_builder_copy( b, tmp );
+                break;
+            }
+        }
+        if ( sl_grow( sp, (uint64_t)len + b->len + 1 ) == NULL ) {
+            sl_free( tmp );
+            return NULL;
+        }
+    }
+
+    if ( tmp )
+        memcpy( *sp + len, tmp, b->len );
+    else
+        sl_builder_copy( b, *sp + len );
+
+    len += b->len;
+    ( *sp )[ len ] = 0;
+    sl_len( *sp ) = len;
+
+    sl_free( tmp );
+    if ( b->frag != b->frag_buf )
+        sl_free( b->frag );
+    if ( b->data != b->data_buf )
+        sl_free( b->data );
+    sl_builder_begin( b );
+
+    return *sp;
+}
+
+
+sl_t sl_concat_many( sl_p sp, ... )
+{
+    sl_builder_t b;
+    va_list      ap;
+    char*        cs;
+
+    sl_builder_begin( &b );
+
+    va_start( ap, sp );
+    while ( ( cs = va_arg( ap, char* ) ) )
+        sl_builder_add_c( &b, cs );
+    va_end( ap );
+
+    return sl_builder_end( &b, sp );
+}
+
+
+int sl_divide_with_char( sl_t ss, char c, int size, char*** div )
+{
+    if ( size < 0 ) {
+        /* Just count size, don't replace chars. */
+        return sl_divide_base( ss, c, -1, NULL );
+    } else if ( *div ) {
+        /* Use pre-allocated storage. */
+        return sl_divide_base( ss, c, size, *div );
+    } else {
+        /* Calculate size and allocate storage. */
+        size = sl_divide_base( ss, c, -1, NULL );
+        *div = (char**)sl_malloc( size * sizeof( char* ) );
+        return sl_divide_base( ss, c, size, *div );
+    }
+}
+
+
+int sl_segment_with_str( sl_t ss, char* sc, int size, char*** div )
+{
+    struct sl_pattern_s pat = { sc, sc_len( sc ), NULL };
+    return sl_segment_alloc( ss, &pat, size, div );
+}
+
+
+int sl_segment_with_pattern( sl_t ss, sl_pattern_t pat, int size, char*** div )
+{
+    return sl_segment_alloc( ss, pat, size, div );
+}
+
+
+sl_t sl_glue_array( sl_v sa, sl_size_t size, char* glu )
+{
+    uint64_t  len = 0;
+    sl_size_t i;
+
+    /* Calc sa len. */
+    i = 0;
+    while ( i < size )
+        len += strlen( sa[ i++ ] );
+
+    /* Add glu len. */
+    len += ( size - 1 ) * strlen( glu );
+
+    /* Result must fit to SL storage (including null). */
+    if ( len >= sl_size_max )
+        return NULL;
+
+    sl_t ss;
+    ss = sl_new( len + 1 );
+    sl_len( ss ) = len;
+
+    /* Build result. */
+    char* p = ss;
+    i = 0;
+    while ( i < size ) {
+        p = sl_copy_setup( p, sa[ i ] );
+        if ( i < ( size - 1 ) )
+            p = sl_copy_setup( p, glu );
+        i++;
+    }
+    ss[ sl_len( ss ) ] = 0;
+
+    return ss;
+}
+
+
+char* sl_tokenize( sl_t ss, char* delim, char** pos )
+{
+    sl_unhash( ss );
+
+    if ( *pos == 0 ) {
+        /* First iteration. */
+        sl_pos_t idx;
+        idx = sl_find_index( ss, delim );
+        if ( idx < 0 )
             return NULL;
         else {
             ss[ idx ] = 0;
@@ -774,8 +1909,8 @@ char* sl_tokenize( sl_t ss, char* delim, char** pos )
         }
 
         /* Find next delim. */
-        int idx;
-        idx = sl_find_index( p, delim );
+        sl_pos_t idx;
+        idx = sl_find_base( p, sl_end( ss ) - p, delim, sc_len( delim ) );
         if ( idx < 0 ) {
             /* Last token, mark this by: */
             *pos = sl_end( ss );
@@ -789,6 +1924,46 @@ char* sl_tokenize( sl_t ss, char* delim, char** pos )
 }
 
 
+void sl_split_begin( sl_split_iter_t* it, sl_t ss, char* delim )
+{
+    it->cur = ss;
+    it->end = sl_end( ss );
+    it->delim = delim;
+    it->dlen = sc_len( delim );
+    it->done = 0;
+}
+
+
+int sl_split_next( sl_split_iter_t* it, char** ptr, sl_size_t* len )
+{
+    if ( it->done )
+        return 0;
+
+    const char* p;
+    size_t      rem = it->end - it->cur;
+
+    if ( it->dlen == 1 ) {
+        p = memchr( it->cur, it->delim[ 0 ], rem );
+    } else {
+        sl_pos_t idx = sl_find_base( it->cur, rem, it->delim, it->dlen );
+        p = idx < 0 ? NULL : it->cur + idx;
+    }
+
+    *ptr = (char*)it->cur;
+
+    if ( p == NULL ) {
+        /* Last token. */
+        *len = rem;
+        it->done = 1;
+    } else {
+        *len = p - it->cur;
+        it->cur = p + it->dlen;
+    }
+
+    return 1;
+}
+
+
 sl_t sl_rm_extension( sl_t ss, char* ext )
 {
     char* pos;
@@ -806,15 +1981,16 @@ sl_t sl_rm_extension( sl_t ss, char* ext )
 
 sl_t sl_directory_name( sl_t ss )
 {
-    int i;
+    sl_size_t i;
+
+    sl_unhash( ss );
 
     /* Find first "/" from end. */
-    i = sl_len( ss );
-    while ( i > 0 && ss[ i ] != '/' )
-        i--;
+    sl_pos_t pos = sl_rchr_base( ss, sl_len( ss ), '/' );
+    i = pos < 0 ? 0 : pos;
 
     if ( i == 0 ) {
-        if ( ss[ i ] == '/' ) {
+        if ( pos == 0 ) {
             ss[ 1 ] = 0;
             sl_len( ss ) = 1;
         } else {
@@ -834,17 +2010,17 @@ sl_t sl_directory_name( sl_t ss )
 
 sl_t sl_basename( sl_t ss )
 {
-    int i;
+    sl_size_t i;
+
+    sl_unhash( ss );
 
     /* Find first "/" from end. */
-    i = sl_len( ss );
-    while ( i > 0 && ss[ i ] != '/' )
-        i--;
+    sl_pos_t pos = sl_rchr_base( ss, sl_len( ss ), '/' );
 
-    if ( i == 0 && ss[ i ] != '/' ) {
+    if ( pos < 0 ) {
         return ss;
     } else {
-        i++;
+        i = pos + 1;
         sl_len( ss ) = sl_len( ss ) - i;
         memmove( ss, &( ss[ i ] ), sl_len( ss ) );
         ss[ sl_len( ss ) ] = 0;
@@ -858,6 +2034,8 @@ sl_t sl_swap_chars( sl_t ss, char f, char t )
 {
     sl_size_t i;
 
+    sl_unhash( ss );
+
     i = 0;
     while ( i < sl_len( ss ) ) {
         if ( ss[ i ] == f )
@@ -870,109 +2048,230 @@ sl_t sl_swap_chars( sl_t ss, char f, char t )
 
 
 sl_t sl_map_str( sl_p sp, char* f, char* t )
+{
+    struct sl_pattern_s pat = { f, sc_len( f ), NULL };
+    return sl_map_base( sp, &pat, t );
+}
+
+
+sl_t sl_map_pattern( sl_p sp, sl_pattern_t pat, char* t )
+{
+    return sl_map_base( sp, pat, t );
+}
+
+
+sl_t sl_map_many( sl_p sp, char** from, char** to, sl_size_t n )
 {
     /*
-     * If "t" is longer than "f", loop and count how many instances of
-     * "f" is found. Increase size of sp by N*t.len - N*f.len.
+     * Leftmost-longest matching is greedy: at each position take the
+     * longest "from" starting there, or advance by one. Longest match
+     * starting at each position is found with Aho-Corasick automaton
+     * of reversed patterns, scanning blocks of SL from right to
+     * left. Block scan extends by the longest pattern past the block
+     * end. Blocks start where the previous greedy pass ended, hence
+     * each byte is scanned at most twice, regardless of patterns.
      *
-     * Loop and find the next "f" index. Skip upto index and insert "t"
-     * inplace. Continue until "f" is no more found and insert tail of
-     * "sp".
+     * Matches are applied in one left to right pass. If replacements
+     * enlarge the string, the original content is first shifted right
+     * by the largest growth at any match, so that writing never
+     * passes reading.
      */
 
-    sl_size_t f_len = sc_len( f );
-    sl_size_t t_len = sc_len( t );
+    if ( n == 0 )
+        return *sp;
+
+    sl_unshare( sp );
+
+    size_t* flen = sl_malloc( 2 * n * sizeof( size_t ) );
+    size_t* tlen = flen + n;
+    size_t  total = 0;
+    size_t  maxf = 0;
+    for ( sl_size_t i = 0; i < n; i++ ) {
+        flen[ i ] = sc_len( from[ i ] );
+        tlen[ i ] = sc_len( to[ i ] );
+        total += flen[ i ];
+        if ( flen[ i ] > maxf )
+            maxf = flen[ i ];
+    }
 
-    int   idx;
-    char *a, *b;
+    /* Reversed patterns. */
+    char** rev = sl_malloc( n * sizeof( char* ) + total );
+    char*  rp = (char*)( rev + n );
+    for ( sl_size_t i = 0; i < n; i++ ) {
+        rev[ i ] = rp;
+        for ( size_t j = 0; j < flen[ i ]; j++ )
+            *rp++ = from[ i ][ flen[ i ] - 1 - j ];
+    }
 
-    if ( t_len > f_len ) {
-        /* Calculate number of parts. */
-        sl_size_t cnt = 0;
+    sl_ac_node_p ac = sl_ac_build( rev, flen, n );
 
-        /*
-         * Replace XXX with YYYY.
-         *
-         * foooXXXfiiiXXXdiii
-         * foooYYYYfiiiYYYYdiii
-         *
-         * Prepare org before copy as:
-         * --foooXXXfiiiXXXdiii
-         *
-         *   OR
-         *
-         * foooXXXfiiiXXXdiiiXXX
-         * foooYYYYfiiiYYYYdiiiYYYY
-         */
-        a = *sp;
+    sl_ac_match_s* m = NULL;
+    size_t         mcnt = 0;
+    size_t         msize = 0;
 
-        while ( 1 ) {
-            idx = sl_find_index( a, f );
-            if ( idx >= 0 ) {
-                cnt++;
-                a += ( idx + f_len );
-            } else {
-                break;
-            }
+    char*    ss = *sp;
+    size_t   olen = sl_len( ss );
+    size_t   bsize = ( maxf > SL_AC_BLOCK ) ? maxf : SL_AC_BLOCK;
+    int32_t* best = sl_malloc( bsize * sizeof( int32_t ) );
+    size_t   pos = 0;
+    int64_t  delta = 0;
+    int64_t  maxd = 0;
+
+    while ( pos < olen ) {
+
+        size_t a = pos;
+        size_t b = ( olen - a > bsize ) ? a + bsize : olen;
+        size_t e = ( olen - b > maxf ) ? b + maxf : olen;
+
+        /* Longest pattern starting at each block position. */
+        int32_t state = 0;
+        for ( size_t j = e; j > a; j-- ) {
+            state = sl_ac_child( ac, state, ss[ j - 1 ] );
+            if ( j - 1 < b )
+                best[ j - 1 - a ] = ac[ state ].out;
         }
 
-        sl_size_t nlen;
-        sl_size_t olen = sl_len( *sp );
-        nlen = sl_len( *sp ) - ( cnt * f_len ) + ( cnt * t_len );
-        sl_reserve( sp, nlen + 1 );
-        sl_len( *sp ) = nlen;
+        /* Greedy pass, which may end past the block. */
+        while ( pos < b ) {
+            int32_t idx = best[ pos - a ];
+            if ( idx < 0 ) {
+                pos++;
+                continue;
+            }
 
-        /*
-         * Shift original sp content to right in order to enable copying
-         * chars safely from right to left.
-         */
-        b = &( ( *sp )[ nlen - olen ] );
-        memmove( b, *sp, olen + 1 );
-        a = *sp;
-    } else {
-        /*
-         * Replace XXX with YY.
-         *
-         * foooXXXfiiiXXXdiii
-         * foooYYfiiiYYdiii
-         */
-        a = *sp;
-        b = *sp;
+            if ( mcnt == msize ) {
+                msize = msize ? 2 * msize : 16;
+                m = sl_realloc( m, msize * sizeof( sl_ac_match_s ) );
+            }
+            m[ mcnt ].pos = pos;
+            m[ mcnt ].idx = idx;
+            mcnt++;
+
+            delta += (int64_t)tlen[ idx ] - (int64_t)flen[ idx ];
+            if ( delta > maxd )
+                maxd = delta;
+
+            pos += flen[ idx ];
+        }
     }
 
-    while ( *b ) {
-        idx = sl_find_index( b, f );
-        if ( idx >= 0 ) {
-            strncpy( a, b, idx );
-            a += idx;
-            a = sl_copy_setup( a, t );
-            b += ( idx + f_len );
-        } else {
-            a = sl_copy_setup( a, b );
-            *a = 0;
-            break;
+    if ( mcnt > 0 && sl_grow( sp, olen + maxd + 1 ) == NULL ) {
+        /* Result does not fit SL storage, SL is not changed. */
+        ss = NULL;
+    } else if ( mcnt > 0 ) {
+
+        ss = *sp;
+
+        char* src = ss + maxd;
+        char* dst = ss;
+        if ( maxd > 0 )
+            memmove( src, ss, olen + 1 );
+
+        size_t cur = 0;
+        for ( size_t k = 0; k < mcnt; k++ ) {
+            size_t seg = m[ k ].pos - cur;
+            memmove( dst, src + cur, seg );
+            dst += seg;
+            memcpy( dst, to[ m[ k ].idx ], tlen[ m[ k ].idx ] );
+            dst += tlen[ m[ k ].idx ];
+            cur = m[ k ].pos + flen[ m[ k ].idx ];
         }
+        memmove( dst, src + cur, olen - cur );
+        dst += olen - cur;
+
+        *dst = 0;
+        sl_len( ss ) = dst - ss;
     }
 
-    if ( *b == 0 )
-        *a = 0;
+    sl_free( m );
+    sl_free( best );
+    sl_free( ac );
+    sl_free( rev );
+    sl_free( flen );
 
-    return *sp;
+    return ss ? *sp : NULL;
 }
 
 
-sl_t sl_capitalize( sl_t ss )
+sl_pattern_t sl_pattern_compile( char* needle )
 {
-    if ( sl_len( ss ) > 0 )
-        ss[ 0 ] = toupper( ss[ 0 ] );
+    size_t       nlen = sc_len( needle );
+    sl_pattern_p pat;
+
+    if ( nlen >= SL_PATTERN_SKIP_MIN ) {
+        pat = sl_malloc( sizeof( struct sl_pattern_s ) + 256 * sizeof( uint32_t ) + nlen + 1 );
+        pat->skip = (uint32_t*)( pat + 1 );
+        pat->ndl = (char*)( pat->skip + 256 );
+
+        for ( int i = 0; i < 256; i++ )
+            pat->skip[ i ] = nlen;
+        for ( size_t i = 0; i < nlen - 1; i++ )
+            pat->skip[ (unsigned char)needle[ i ] ] = nlen - 1 - i;
+    } else {
+        pat = sl_malloc( sizeof( struct sl_pattern_s ) + nlen + 1 );
+        pat->skip = NULL;
+        pat->ndl = (char*)( pat + 1 );
+    }
 
-    return ss;
+    memcpy( pat->ndl, needle, nlen + 1 );
+    pat->nlen = nlen;
+
+    return pat;
 }
 
 
-sl_t sl_toupper( sl_t ss )
+sl_pattern_t sl_pattern_del( sl_pattern_t* pp )
 {
-    for ( sl_size_t i = 0; i < sl_len( ss ); i++ ) {
+    sl_free( *pp );
+    *pp = NULL;
+    return NULL;
+}
+
+
+sl_pos_t sl_pattern_find( sl_pattern_t pat, sl_t ss )
+{
+    return sl_pattern_base( pat, ss, sl_len( ss ) );
+}
+
+
+sl_size_t sl_pattern_count( sl_pattern_t pat, sl_t ss )
+{
+    return sl_pattern_find_all( pat, ss, NULL, 0 );
+}
+
+
+sl_size_t sl_pattern_find_all( sl_pattern_t pat, sl_t ss, sl_pos_t* idx, sl_size_t size )
+{
+    sl_size_t cnt = 0;
+    sl_size_t pos = 0;
+    sl_pos_t  hit;
+
+    while ( ( hit = sl_pattern_base( pat, ss + pos, sl_len( ss ) - pos ) ) >= 0 ) {
+        if ( cnt < size )
+            idx[ cnt ] = pos + hit;
+        cnt++;
+        pos += hit + pat->nlen;
+    }
+
+    return cnt;
+}
+
+
+sl_t sl_capitalize( sl_t ss )
+{
+    sl_unhash( ss );
+
+    if ( sl_len( ss ) > 0 )
+        ss[ 0 ] = toupper( ss[ 0 ] );
+
+    return ss;
+}
+
+
+sl_t sl_toupper( sl_t ss )
+{
+    sl_unhash( ss );
+    for ( sl_size_t i = 0; i < sl_len( ss ); i++ ) {
         ss[ i ] = toupper( ss[ i ] );
     }
     return ss;
@@ -981,6 +2280,7 @@ sl_t sl_toupper( sl_t ss )
 
 sl_t sl_tolower( sl_t ss )
 {
+    sl_unhash( ss );
     for ( sl_size_t i = 0; i < sl_len( ss ); i++ ) {
         ss[ i ] = tolower( ss[ i ] );
     }
@@ -996,22 +2296,110 @@ sl_t sl_read_file( char* filename )
     if ( size < 0 )
         return NULL; // GCOV_EXCL_LINE
 
-    ss = sl_new( size + 1 );
+    /* File must fit to SL storage (including null). */
+    if ( (uint64_t)size >= sl_size_max )
+        return NULL; // GCOV_EXCL_LINE
 
     int fd;
 
     fd = open( filename, O_RDONLY );
     if ( fd == -1 )
         return NULL; // GCOV_EXCL_LINE
-    read( fd, ss, size );
-    ss[ size ] = 0;
-    sl_len( ss ) = size;
+
+    ss = sl_new( size + 1 );
+
+    /* Read returns at most 2 GiB, and it might be interrupted. */
+    sl_size_t len = 0;
+    ssize_t   cnt;
+    while ( len < (sl_size_t)size ) {
+        cnt = read( fd, ss + len, size - len );
+        if ( cnt > 0 ) {
+            len += cnt;
+        } else if ( cnt == 0 ) {
+            break; // GCOV_EXCL_LINE
+        } else if ( errno != EINTR ) {
+            close( fd );     // GCOV_EXCL_LINE
+            sl_del( &ss );   // GCOV_EXCL_LINE
+            return NULL;     // GCOV_EXCL_LINE
+        }
+    }
+
+    ss[ len ] = 0;
+    sl_len( ss ) = len;
     close( fd );
 
     return ss;
 }
 
 
+sl_t sl_map_file( char* filename, int flags )
+{
+    /*
+     * Mapping layout:
+     *
+     *     [page: ext, descriptor][file pages][zero page]
+     *
+     * Headers are at the end of the anonymous first page, and file
+     * content starts at the next page. Content is followed by zeros,
+     * either from the file's last page or from the trailing page,
+     * hence SL is null terminated.
+     */
+
+    struct stat st;
+    size_t      page = sysconf( _SC_PAGESIZE );
+    size_t      size;
+    char*       base;
+    sl_ext_p    x;
+    sl_base_p   s;
+    int         fd;
+
+    fd = open( filename, O_RDONLY );
+    if ( fd == -1 )
+        return NULL;
+
+    /* File must fit to SL storage (including null). */
+    if ( fstat( fd, &st ) != 0 || (uint64_t)st.st_size >= sl_size_max ) {
+        close( fd ); // GCOV_EXCL_LINE
+        return NULL; // GCOV_EXCL_LINE
+    }
+
+    size = page + ( ( st.st_size + page ) & ~( page - 1 ) );
+    base = mmap( NULL, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( base == MAP_FAILED ) {
+        close( fd ); // GCOV_EXCL_LINE
+        return NULL; // GCOV_EXCL_LINE
+    }
+
+    if ( st.st_size > 0
+         && mmap( base + page, st.st_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0 ) == MAP_FAILED ) {
+        munmap( base, size ); // GCOV_EXCL_LINE
+        close( fd );          // GCOV_EXCL_LINE
+        return NULL;          // GCOV_EXCL_LINE
+    }
+    close( fd );
+
+    /* Header page is written once, and hash may be cached later. */
+    mprotect( base, page, PROT_READ | PROT_WRITE );
+
+    s = (sl_base_p)( base + page - sizeof( sl_s ) );
+    x = sl_ext( s );
+    x->size = size;
+    x->kind = SL_KIND_MAPPED;
+    x->hash = 0;
+    s->res = ( st.st_size + 1 ) | SL_EXT_FLAG;
+    s->len = st.st_size;
+
+    if ( st.st_size > 0 ) {
+        if ( flags & SL_MMAP_SEQUENTIAL )
+            madvise( base + page, st.st_size, MADV_SEQUENTIAL );
+        if ( flags & SL_MMAP_WILLNEED )
+            madvise( base + page, st.st_size, MADV_WILLNEED );
+    }
+
+    return sl_str( s );
+}
+
+
 sl_t sl_write_file( sl_t ss, char* filename )
 {
     int fd;
@@ -1026,351 +2414,3902 @@ sl_t sl_write_file( sl_t ss, char* filename )
 }
 
 
-void sl_print( sl_t ss )
+void sl_print( sl_t ss )
+{
+    printf( "%s\n", ss );
+    printf( "  len: %llu\n", (unsigned long long)sl_len( ss ) );
+    printf( "  res: %llu\n", (unsigned long long)sl_res( ss ) );
+}
+
+
+void sl_gap_begin( sl_gap_t* g, sl_p sp, sl_pos_t pos )
+{
+    /* Spare storage is the gap, hence gap is initially at the end. */
+    sl_unshare( sp );
+    if ( sl_res( *sp ) == 0 )
+        sl_reserve( sp, 1 );
+    g->sp = sp;
+    g->len = sl_len( *sp );
+    g->pos = g->len;
+    g->end = sl_res( *sp ) - 1;
+    sl_gap_move( g, pos );
+}
+
+
+void sl_gap_move( sl_gap_t* g, sl_pos_t pos )
+{
+    sl_size_t posn = sl_norm_idx( g->len, pos );
+    char*     ss = *g->sp;
+
+    if ( posn < g->pos ) {
+        sl_size_t cnt = g->pos - posn;
+        memmove( ss + g->end - cnt, ss + posn, cnt );
+        g->pos -= cnt;
+        g->end -= cnt;
+    } else if ( posn > g->pos ) {
+        sl_size_t cnt = posn - g->pos;
+        memmove( ss + g->pos, ss + g->end, cnt );
+        g->pos += cnt;
+        g->end += cnt;
+    }
+}
+
+
+void sl_gap_insert( sl_gap_t* g, sl_view_t v )
+{
+    if ( g->end - g->pos < v.len ) {
+        /* Grow with gap at the end, where storage resize preserves
+         * content. */
+        sl_size_t pos = g->pos;
+        sl_gap_move( g, g->len );
+        sl_len( *g->sp ) = g->len;
+        sl_reserve_with( g->sp, g->len + v.len + 1, SL_GROW_GEOMETRIC );
+        g->end = sl_res( *g->sp ) - 1;
+        sl_gap_move( g, pos );
+    }
+
+    memcpy( *g->sp + g->pos, v.ptr, v.len );
+    g->pos += v.len;
+    g->len += v.len;
+}
+
+
+void sl_gap_push_char( sl_gap_t* g, char c )
+{
+    if ( g->pos < g->end ) {
+        ( *g->sp )[ g->pos++ ] = c;
+        g->len++;
+    } else {
+        sl_view_t v = { &c, 1 };
+        sl_gap_insert( g, v );
+    }
+}
+
+
+void sl_gap_delete( sl_gap_t* g, sl_size_t cnt )
+{
+    sl_size_t tail = g->len - g->pos;
+    if ( cnt > tail )
+        cnt = tail;
+    g->end += cnt;
+    g->len -= cnt;
+}
+
+
+void sl_gap_backspace( sl_gap_t* g, sl_size_t cnt )
+{
+    if ( cnt > g->pos )
+        cnt = g->pos;
+    g->pos -= cnt;
+    g->len -= cnt;
+}
+
+
+sl_size_t sl_gap_length( sl_gap_t* g )
+{
+    return g->len;
+}
+
+
+sl_t sl_gap_end( sl_gap_t* g )
+{
+    sl_unhash( *g->sp );
+    sl_gap_move( g, g->len );
+    ( *g->sp )[ g->len ] = 0;
+    sl_len( *g->sp ) = g->len;
+    return *g->sp;
+}
+
+
+sl_rope_t sl_rope_new( sl_view_t init )
+{
+    sl_rope_t r = sl_malloc( sizeof( struct sl_rope_s ) );
+    r->root = NULL;
+    r->seed = 0x9e3779b9;
+    sl_rope_insert( r, 0, init );
+    return r;
+}
+
+
+sl_rope_t sl_rope_del( sl_rope_t* rp )
+{
+    sl_rope_free( ( *rp )->root );
+    sl_free( *rp );
+    *rp = NULL;
+    return NULL;
+}
+
+
+sl_size_t sl_rope_length( sl_rope_t r )
+{
+    return r->root ? r->root->size : 0;
+}
+
+
+void sl_rope_insert( sl_rope_t r, sl_size_t pos, sl_view_t v )
+{
+    sl_rope_node_p a, b, m;
+    size_t         off;
+
+    if ( v.len == 0 )
+        return;
+
+    if ( pos > sl_rope_length( r ) )
+        pos = sl_rope_length( r );
+
+    if ( r->root ) {
+        /* Insert to existing chunk, if it fits. */
+        m = sl_rope_locate( r->root, pos, 0, &off, 0 );
+        if ( sl_len( m->str ) + v.len <= SL_ROPE_LEAF ) {
+            sl_rope_locate( r->root, pos, 0, &off, v.len );
+            sl_grow( &m->str, sl_len( m->str ) + v.len + 1 );
+            memmove( m->str + off + v.len, m->str + off, sl_len( m->str ) - off + 1 );
+            memcpy( m->str + off, v.ptr, v.len );
+            sl_len( m->str ) += v.len;
+            return;
+        }
+    }
+
+    /* Create new chunks and merge them between the split parts. */
+    m = NULL;
+    for ( size_t i = 0; i < v.len; i += SL_ROPE_LEAF ) {
+        size_t n = v.len - i < SL_ROPE_LEAF ? v.len - i : SL_ROPE_LEAF;
+        m = sl_rope_merge( m, sl_rope_leaf( v.ptr + i, n, sl_rope_rand( r ) ) );
+    }
+
+    sl_rope_split( r->root, pos, &a, &b );
+    r->root = sl_rope_merge( sl_rope_merge( a, m ), b );
+}
+
+
+void sl_rope_delete( sl_rope_t r, sl_size_t pos, sl_size_t len )
+{
+    sl_rope_node_p a, b, m;
+    size_t         off;
+
+    if ( pos >= sl_rope_length( r ) || len == 0 )
+        return;
+
+    if ( len > sl_rope_length( r ) - pos )
+        len = sl_rope_length( r ) - pos;
+
+    /* Delete within chunk, if chunk is not emptied. */
+    m = sl_rope_locate( r->root, pos, 1, &off, 0 );
+    if ( off + len < sl_len( m->str ) ) {
+        sl_rope_locate( r->root, pos, 1, &off, -(int64_t)len );
+        memmove( m->str + off, m->str + off + len, sl_len( m->str ) - off - len + 1 );
+        sl_len( m->str ) -= len;
+        return;
+    }
+
+    sl_rope_split( r->root, pos, &a, &b );
+    sl_rope_split( b, len, &m, &b );
+    sl_rope_free( m );
+    r->root = sl_rope_merge( a, b );
+}
+
+
+sl_t sl_rope_slice( sl_rope_t r, sl_size_t pos, sl_size_t len )
+{
+    sl_t ss;
+
+    if ( pos > sl_rope_length( r ) )
+        pos = sl_rope_length( r );
+
+    if ( len > sl_rope_length( r ) - pos )
+        len = sl_rope_length( r ) - pos;
+
+    if ( len >= sl_size_max )
+        return NULL;
+
+    ss = sl_new( len + 1 );
+    sl_rope_copy( r->root, pos, len, ss );
+    ss[ len ] = 0;
+    sl_len( ss ) = len;
+
+    return ss;
+}
+
+
+sl_pos_t sl_rope_find( sl_rope_t r, sl_view_t ndl, sl_size_t pos )
+{
+    size_t   total = sl_rope_length( r );
+    size_t   off, end, k, m;
+    char*    win = NULL;
+    sl_pos_t hit;
+    sl_pos_t ret = -1;
+
+    if ( ndl.len == 0 )
+        return -1;
+
+    if ( ndl.len > 1 )
+        win = sl_malloc( 2 * ( ndl.len - 1 ) );
+
+    while ( pos < total ) {
+
+        sl_rope_node_p t = sl_rope_locate( r->root, pos, 1, &off, 0 );
+
+        hit = sl_find_base( t->str + off, sl_len( t->str ) - off, ndl.ptr, ndl.len );
+        if ( hit >= 0 ) {
+            ret = pos + hit;
+            break;
+        }
+
+        end = pos + sl_len( t->str ) - off;
+
+        if ( win && end < total ) {
+            /* Matches crossing the chunk end. */
+            k = sl_len( t->str ) - off;
+            k = k < ndl.len - 1 ? k : ndl.len - 1;
+            m = total - end < ndl.len - 1 ? total - end : ndl.len - 1;
+            sl_rope_copy( r->root, end - k, k + m, win );
+            hit = sl_find_base( win, k + m, ndl.ptr, ndl.len );
+            if ( hit >= 0 && (size_t)hit < k ) {
+                ret = end - k + hit;
+                break;
+            }
+        }
+
+        pos = end;
+    }
+
+    sl_free( win );
+
+    return ret;
+}
+
+
+sl_t sl_rope_flatten( sl_rope_t r )
+{
+    return sl_rope_slice( r, 0, sl_rope_length( r ) );
+}
+
+
+sl_intern_t sl_intern_new( void )
+{
+    sl_intern_t t;
+
+    t = sl_malloc( sizeof( struct sl_intern_s ) );
+    for ( int i = 0; i < ( 1 << SL_INTERN_BITS ); i++ ) {
+        pthread_mutex_init( &t->shard[ i ].lock, NULL );
+        t->shard[ i ].map = sl_map_new( 0 );
+        t->shard[ i ].arena = sl_arena_new( 0 );
+    }
+
+    return t;
+}
+
+
+sl_intern_t sl_intern_del( sl_intern_t* tp )
+{
+    sl_intern_t t = *tp;
+
+    for ( int i = 0; i < ( 1 << SL_INTERN_BITS ); i++ ) {
+        pthread_mutex_destroy( &t->shard[ i ].lock );
+        sl_map_del( &t->shard[ i ].map );
+        sl_arena_del( &t->shard[ i ].arena );
+    }
+    sl_free( t );
+    *tp = NULL;
+
+    return NULL;
+}
+
+
+sl_t sl_intern( sl_intern_t t, char* cs )
+{
+    return sl_intern_base( t, cs, sc_len( cs ) );
+}
+
+
+sl_t sl_intern_view( sl_intern_t t, sl_view_t v )
+{
+    return sl_intern_base( t, v.ptr, v.len );
+}
+
+
+sl_size_t sl_intern_count( sl_intern_t t )
+{
+    sl_size_t cnt = 0;
+
+    for ( int i = 0; i < ( 1 << SL_INTERN_BITS ); i++ ) {
+        pthread_mutex_lock( &t->shard[ i ].lock );
+        cnt += t->shard[ i ].map->cnt;
+        pthread_mutex_unlock( &t->shard[ i ].lock );
+    }
+
+    return cnt;
+}
+
+
+sl_table_t sl_table_new( sl_size_t size )
+{
+    sl_table_t t;
+
+    if ( size == 0 )
+        size = 16;
+
+    t = sl_malloc( sizeof( struct sl_table_s ) );
+    t->res = size;
+    t->off = sl_malloc( size * sizeof( sl_size_t ) );
+    t->size = size * 16;
+    t->data = sl_malloc( t->size );
+
+    /* Space for the would-be "res" field of the first record. */
+    t->used = sizeof( sl_size_t );
+    t->cnt = 0;
+
+    return t;
+}
+
+
+sl_table_t sl_table_del( sl_table_t* tp )
+{
+    sl_free( ( *tp )->data );
+    sl_free( ( *tp )->off );
+    sl_free( *tp );
+    *tp = NULL;
+    return NULL;
+}
+
+
+sl_size_t sl_table_add( sl_table_t t, sl_t ss )
+{
+    return sl_table_add_view( t, sl_view( ss ) );
+}
+
+
+sl_size_t sl_table_add_c( sl_table_t t, char* cs )
+{
+    return sl_table_add_view( t, sl_view_c( cs ) );
+}
+
+
+sl_size_t sl_table_add_view( sl_table_t t, sl_view_t v )
+{
+    size_t rec = sl_talign( sizeof( sl_size_t ) + v.len + 1 );
+    char*  str;
+
+    if ( t->used + rec > t->size ) {
+        /* Self append, view moves with data. */
+        int    self = ( v.ptr >= t->data && v.ptr < t->data + t->used );
+        size_t off = self ? (size_t)( v.ptr - t->data ) : 0;
+
+        while ( t->used + rec > t->size )
+            t->size *= 2;
+        t->data = sl_realloc( t->data, t->size );
+
+        if ( self )
+            v.ptr = t->data + off;
+    }
+
+    if ( t->cnt == t->res ) {
+        t->res *= 2;
+        t->off = sl_realloc( t->off, t->res * sizeof( sl_size_t ) );
+    }
+
+    str = t->data + t->used + sizeof( sl_size_t );
+    sl_len( str ) = v.len;
+    memcpy( str, v.ptr, v.len );
+    str[ v.len ] = 0;
+
+    t->off[ t->cnt ] = str - t->data;
+    t->used += rec;
+
+    return t->cnt++;
+}
+
+
+sl_size_t sl_table_count( sl_table_t t )
+{
+    return t->cnt;
+}
+
+
+sl_view_t sl_table_get( sl_table_t t, sl_size_t idx )
+{
+    char*     str = t->data + t->off[ idx ];
+    sl_view_t v = { str, sl_len( str ) };
+    return v;
+}
+
+
+void sl_table_sort( sl_table_t t, int flags )
+{
+    sl_sort_item_s* it;
+    sl_sort_item_s* aux = NULL;
+    sl_size_t       n = t->cnt;
+
+    if ( n < 2 )
+        return;
+
+    it = sl_malloc( n * sizeof( sl_sort_item_s ) * ( ( flags & SL_SORT_STABLE ) ? 2 : 1 ) );
+    if ( flags & SL_SORT_STABLE )
+        aux = it + n;
+
+    for ( sl_size_t i = 0; i < n; i++ )
+        it[ i ].str = t->data + t->off[ i ];
+
+    /* Records have SL compatible length. */
+    sl_sort_radix( it, aux, n, 0, flags | SL_SORT_LEN );
+
+    for ( sl_size_t i = 0; i < n; i++ )
+        t->off[ i ] = it[ i ].str - t->data;
+
+    sl_free( it );
+}
+
+
+sl_t sl_table_join( sl_table_t t, char* glu )
+{
+    sl_size_t glen = sc_len( glu );
+    uint64_t  len = 0;
+    sl_t      ss;
+    char*     p;
+
+    for ( sl_size_t i = 0; i < t->cnt; i++ )
+        len += sl_len( t->data + t->off[ i ] );
+    if ( t->cnt > 0 )
+        len += (uint64_t)( t->cnt - 1 ) * glen;
+
+    /* Result must fit to SL storage (including null). */
+    if ( len >= sl_size_max )
+        return NULL;
+
+    ss = sl_new( len + 1 );
+    p = ss;
+    for ( sl_size_t i = 0; i < t->cnt; i++ ) {
+        char* str = t->data + t->off[ i ];
+        if ( i > 0 ) {
+            memcpy( p, glu, glen );
+            p += glen;
+        }
+        memcpy( p, str, sl_len( str ) );
+        p += sl_len( str );
+    }
+    *p = 0;
+    sl_len( ss ) = len;
+
+    return ss;
+}
+
+
+int sl_table_next( sl_table_t t, sl_size_t* iter, sl_view_t* v )
+{
+    if ( *iter < t->cnt ) {
+        *v = sl_table_get( t, ( *iter )++ );
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+sl_map_t sl_map_new( sl_size_t size )
+{
+    sl_map_p m;
+    size_t   cap = SL_MAP_GROUP;
+
+    /* Fit "size" entries within load limit. */
+    while ( cap - cap / 8 < size )
+        cap *= 2;
+
+    m = sl_malloc( sizeof( struct sl_map_s ) );
+    sl_map_alloc( m, cap );
+
+    return m;
+}
+
+
+sl_map_t sl_map_del( sl_map_t* mp )
+{
+    sl_map_p m = *mp;
+
+    for ( size_t i = 0; i < m->cap; i++ ) {
+        if ( !( m->ctrl[ i ] & 0x80 ) )
+            sl_del( &m->slot[ i ].key );
+    }
+
+    sl_free( m->ctrl );
+    sl_free( m->slot );
+    sl_free( m );
+    *mp = NULL;
+
+    return NULL;
+}
+
+
+void sl_map_put( sl_map_t m, sl_t key, void* val )
+{
+    uint32_t h = sl_hash( key );
+    size_t   i = sl_map_find( m, key, sl_len( key ), h );
+    sl_t     k;
+
+    if ( i != SIZE_MAX ) {
+        m->slot[ i ].val = val;
+        return;
+    }
+
+    k = sl_new_hashable( sl_len( key ) + 1 );
+    memcpy( k, key, sl_len( key ) + 1 );
+    sl_len( k ) = sl_len( key );
+    sl_ext( sl_base( k ) )->hash = h;
+
+    sl_map_add( m, k, val );
+}
+
+
+void* sl_map_get( sl_map_t m, sl_t key )
+{
+    size_t i = sl_map_find( m, key, sl_len( key ), sl_hash( key ) );
+
+    if ( i != SIZE_MAX )
+        return m->slot[ i ].val;
+    else
+        return NULL;
+}
+
+
+int sl_map_has( sl_map_t m, sl_t key )
+{
+    return sl_map_find( m, key, sl_len( key ), sl_hash( key ) ) != SIZE_MAX;
+}
+
+
+int sl_map_remove( sl_map_t m, sl_t key )
+{
+    size_t i = sl_map_find( m, key, sl_len( key ), sl_hash( key ) );
+
+    if ( i == SIZE_MAX )
+        return 0;
+
+    sl_del( &m->slot[ i ].key );
+    m->slot[ i ].val = NULL;
+    m->cnt--;
+
+    /*
+     * Slot can be emptied if no group window covering it has ever
+     * been full, since then no probe has continued past it.
+     */
+    uint32_t before = sl_map_match( &m->ctrl[ ( i - SL_MAP_GROUP ) & ( m->cap - 1 ) ], SL_MAP_EMPTY );
+    uint32_t after = sl_map_match( &m->ctrl[ i ], SL_MAP_EMPTY );
+    if ( before && after
+         && __builtin_ctz( after ) + __builtin_clz( before ) - ( 32 - SL_MAP_GROUP ) < SL_MAP_GROUP ) {
+        sl_map_set_ctrl( m, i, SL_MAP_EMPTY );
+        m->left++;
+    } else {
+        sl_map_set_ctrl( m, i, SL_MAP_DELETED );
+    }
+
+    return 1;
+}
+
+
+sl_size_t sl_map_count( sl_map_t m )
+{
+    return m->cnt;
+}
+
+
+int sl_map_next( sl_map_t m, sl_size_t* iter, sl_t* key, void** val )
+{
+    while ( *iter < m->cap ) {
+        size_t i = ( *iter )++;
+        if ( !( m->ctrl[ i ] & 0x80 ) ) {
+            if ( key )
+                *key = m->slot[ i ].key;
+            if ( val )
+                *val = m->slot[ i ].val;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+
+
+/* ------------------------------------------------------------
+ * Utility functions.
+ * ------------------------------------------------------------ */
+
+
+/**
+ * Copy "src" to "dst" and return pointer to end of "dst".
+ *
+ * @param dst Destination str.
+ * @param src Source str.
+ *
+ * @return Pointer to dst end.
+ */
+static char* sl_copy_setup( char* dst, char* src )
+{
+    size_t i = 0;
+    while ( src[ i ] ) {
+        dst[ i ] = src[ i ];
+        i++;
+    }
+    return &( dst[ i ] );
+}
+
+
+/**
+ * Calculate storage size for growth policy.
+ *
+ * @param res  Current storage size.
+ * @param size Requested storage size.
+ * @param grow Growth policy.
+ *
+ * @return Storage size (at least "size").
+ */
+static sl_size_t sl_grow_size( sl_size_t res, sl_size_t size, sl_grow_t grow )
+{
+    switch ( grow ) {
+
+        case SL_GROW_GEOMETRIC: {
+            uint64_t geo = (uint64_t)res + ( (uint64_t)res * sl_grow_factor ) / 100;
+            if ( geo > sl_size_max )
+                geo = sl_size_max;
+            if ( geo > size )
+                size = geo;
+            break;
+        }
+
+        case SL_GROW_CLASS: {
+            uint64_t cls = sizeof( sl_s );
+            while ( cls < sl_malsize( (uint64_t)size ) )
+                cls <<= 1;
+            if ( cls - sizeof( sl_s ) <= sl_size_max )
+                size = cls - sizeof( sl_s );
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    return size;
+}
+
+
+/**
+ * Reserve storage with the configured growth policy.
+ *
+ * Size is taken as 64-bit, so that overflowing sums of SL lengths
+ * are caught by the limit check.
+ *
+ * @param sp   SLP.
+ * @param size Requested storage size.
+ *
+ * @return SL (or NULL if size exceeds storage limit).
+ */
+static sl_t sl_grow( sl_p sp, uint64_t size )
+{
+    if ( size > sl_size_max )
+        return NULL;
+
+    return sl_reserve_with( sp, size, sl_grow_policy );
+}
+
+
+/**
+ * Allocate heap SL.
+ *
+ * Small SLs are always allocated at class size, whether pool is
+ * enabled or not. Hence storage size alone tells the block size, and
+ * pool can be enabled or disabled while heap SLs exist.
+ *
+ * @param size String storage size.
+ *
+ * @return SL base (with "res" set).
+ */
+static sl_base_p sl_heap_alloc( sl_size_t size )
+{
+    sl_base_p s;
+    int       cls;
+
+    if ( ( cls = sl_pool_class( size ) ) >= 0 )
+        s = sl_pool_get( cls );
+    else
+        s = (sl_base_p)sl_malloc( sl_malsize( size ) );
+
+    s->res = size;
+
+    return s;
+}
+
+
+/**
+ * Resize heap SL.
+ *
+ * Resize within class only updates storage size, and resize to
+ * another class moves SL to a class sized block. Class blocks are
+ * heap allocations, hence they can be re-allocated beyond the
+ * largest class.
+ *
+ * @param s    SL base.
+ * @param size String storage size.
+ *
+ * @return SL base (possibly moved).
+ */
+static sl_base_p sl_heap_resize( sl_base_p s, sl_size_t size )
+{
+    int ocls = sl_pool_class( s->res );
+    int ncls = sl_pool_class( size );
+
+    if ( ncls >= 0 && ncls == ocls ) {
+        s->res = size;
+        return s;
+    } else if ( ncls >= 0 ) {
+        sl_base_p n = sl_pool_get( ncls );
+        memcpy( n, s, sl_malsize( s->len + 1 ) );
+        n->res = size;
+        sl_heap_free( s );
+        return n;
+    } else if ( ocls >= 0 ) {
+        __atomic_sub_fetch( &sl_pool_used[ ocls ], 1, __ATOMIC_RELAXED );
+    }
+
+    s = (sl_base_p)sl_realloc( s, sl_malsize( size ) );
+    s->res = size;
+
+    return s;
+}
+
+
+/**
+ * Free heap SL, to pool if enabled.
+ *
+ * @param s SL base.
+ */
+static void sl_heap_free( sl_base_p s )
+{
+    int cls;
+
+    if ( ( cls = sl_pool_class( s->res ) ) >= 0 )
+        sl_pool_put( s, cls );
+    else
+        sl_free( s );
+}
+
+
+/**
+ * Return pool class for storage size, or -1 if too large for pool.
+ *
+ * @param size String storage size.
+ *
+ * @return Class index.
+ */
+static int sl_pool_class( sl_size_t size )
+{
+    size_t total = sl_malsize( (size_t)size );
+
+    if ( total > ( SL_POOL_MIN << ( SL_POOL_CLASSES - 1 ) ) )
+        return -1;
+    else if ( total <= SL_POOL_MIN )
+        return 0;
+
+    /* Class block is the next power of two. */
+    return 64 - __builtin_clzll( total - 1 ) - __builtin_ctz( SL_POOL_MIN );
+}
+
+
+/**
+ * Get class sized block, from pool if enabled.
+ *
+ * @param cls Class index.
+ *
+ * @return Block as SL base.
+ */
+static sl_base_p sl_pool_get( int cls )
+{
+    sl_block_p b = NULL;
+
+    if ( sl_pool_on ) {
+        if ( ( b = sl_pool.list[ cls ] ) ) {
+            sl_pool.list[ cls ] = b->next;
+            sl_pool.stat.free[ cls ]--;
+            sl_pool.stat.hits++;
+        } else {
+            sl_pool.stat.misses++;
+        }
+    }
+
+    if ( !b )
+        b = (sl_block_p)sl_malloc( SL_POOL_MIN << cls );
+
+    __atomic_add_fetch( &sl_pool_used[ cls ], 1, __ATOMIC_RELAXED );
+
+    return (sl_base_p)b;
+}
+
+
+/**
+ * Put class sized block to pool free list if enabled.
+ *
+ * Block may have been allocated by another thread. Calling thread's
+ * free list takes the block, and it is released at thread exit.
+ *
+ * @param s   SL base.
+ * @param cls Class index.
+ */
+static void sl_pool_put( sl_base_p s, int cls )
+{
+    __atomic_sub_fetch( &sl_pool_used[ cls ], 1, __ATOMIC_RELAXED );
+
+    if ( sl_pool_on && sl_pool.stat.free[ cls ] < SL_POOL_DEPTH ) {
+        sl_block_p b = (sl_block_p)s;
+        if ( !sl_pool.init )
+            sl_pool_init();
+        b->next = sl_pool.list[ cls ];
+        sl_pool.list[ cls ] = b;
+        sl_pool.stat.free[ cls ]++;
+    } else {
+        sl_free( s );
+    }
+}
+
+
+/**
+ * Release free list blocks of pool to heap.
+ *
+ * @param pool Per-thread pool.
+ */
+static void sl_pool_release( sl_pool_s* pool )
+{
+    sl_block_p b, n;
+
+    for ( int cls = 0; cls < SL_POOL_CLASSES; cls++ ) {
+        b = pool->list[ cls ];
+        while ( b ) {
+            n = b->next;
+            sl_free( b );
+            b = n;
+        }
+        pool->list[ cls ] = NULL;
+        pool->stat.free[ cls ] = 0;
+    }
+}
+
+
+/**
+ * Thread exit handler, releases thread's free lists.
+ *
+ * @param arg Per-thread pool.
+ */
+static void sl_pool_exit( void* arg )
+{
+    sl_pool_release( (sl_pool_s*)arg );
+}
+
+
+/**
+ * Create thread exit key for pools.
+ */
+static void sl_pool_key_create( void )
+{
+    pthread_key_create( &sl_pool_key, sl_pool_exit );
+}
+
+
+/**
+ * Register exit handler for calling thread's pool.
+ */
+static void sl_pool_init( void )
+{
+    pthread_once( &sl_pool_once, sl_pool_key_create );
+    pthread_setspecific( sl_pool_key, &sl_pool );
+    sl_pool.init = 1;
+}
+
+
+/**
+ * Resize storage of SL with extension header.
+ *
+ * @param s    SL base.
+ * @param size Storage size.
+ *
+ * @return SL base (possibly moved).
+ */
+static sl_base_p sl_ext_resize( sl_base_p s, sl_size_t size )
+{
+    sl_ext_p x = sl_ext( s );
+
+    switch ( x->kind ) {
+        case SL_KIND_ARENA: return sl_arena_resize( x->owner, s, size );
+        case SL_KIND_USE: return sl_use_resize( s, size );
+        case SL_KIND_HEAP: return sl_hashable_resize( s, size );
+        case SL_KIND_SHARED: return sl_shared_resize( s, size );
+        case SL_KIND_MAPPED: return sl_mapped_resize( s, size );
+        default: return s; // GCOV_EXCL_LINE
+    }
+}
+
+
+/**
+ * Free storage of SL with extension header.
+ *
+ * @param s SL base.
+ */
+static void sl_ext_free( sl_base_p s )
+{
+    sl_ext_p x = sl_ext( s );
+
+    switch ( x->kind ) {
+        case SL_KIND_ARENA: sl_arena_free( x->owner, s ); break;
+        case SL_KIND_USE: break;
+        case SL_KIND_HEAP: sl_free( sl_ext( s ) ); break;
+        case SL_KIND_SHARED: sl_shared_free( s ); break;
+        case SL_KIND_MAPPED: sl_mapped_free( s ); break;
+        default: break; // GCOV_EXCL_LINE
+    }
+}
+
+
+/**
+ * Allocate SL from arena.
+ *
+ * Allocation includes extension header, SL descriptor and string
+ * storage. Arena chunks are taken into use in order, and a new chunk
+ * is added if none of the remaining chunks fit.
+ *
+ * @param a    Arena.
+ * @param size String storage size.
+ *
+ * @return SL base.
+ */
+static sl_base_p sl_arena_alloc( sl_arena_p a, sl_size_t size )
+{
+    size_t     need = sl_align( sizeof( sl_ext_s ) + sl_malsize( (size_t)size ) );
+    sl_chunk_p c = a->cur;
+
+    while ( c && c->size - c->used < need )
+        c = c->next;
+
+    if ( c == NULL ) {
+        size_t csize = a->size;
+        if ( csize < need )
+            csize = need;
+        c = (sl_chunk_p)sl_malloc( sizeof( sl_chunk_s ) + csize );
+        c->size = csize;
+        c->used = 0;
+        if ( a->cur ) {
+            c->next = a->cur->next;
+            a->cur->next = c;
+        } else {
+            c->next = a->head;
+            a->head = c;
+        }
+    }
+
+    sl_ext_p x = (sl_ext_p)( c->data + c->used );
+    c->used += need;
+    a->cur = c;
+    a->last = (char*)x;
+
+    x->owner = a;
+    x->kind = SL_KIND_ARENA;
+    x->hash = 0;
+
+    sl_base_p s = (sl_base_p)( x + 1 );
+    s->res = size | SL_EXT_FLAG;
+    s->len = 0;
+    s->str[ 0 ] = 0;
+
+    return s;
+}
+
+
+/**
+ * Resize arena SL.
+ *
+ * Latest allocation is resized in place, if it fits the current
+ * chunk. Otherwise SL is moved to a new arena allocation, and the old
+ * storage is left unused until arena reset.
+ *
+ * @param a    Arena.
+ * @param s    SL base.
+ * @param size Storage size.
+ *
+ * @return SL base (possibly moved).
+ */
+static sl_base_p sl_arena_resize( sl_arena_p a, sl_base_p s, sl_size_t size )
+{
+    char*  x = (char*)sl_ext( s );
+    size_t need = sl_align( sizeof( sl_ext_s ) + sl_malsize( (size_t)size ) );
+
+    if ( x == a->last && x + need <= a->cur->data + a->cur->size ) {
+        a->cur->used = ( x - a->cur->data ) + need;
+        s->res = size | SL_EXT_FLAG;
+        return s;
+    } else if ( size <= ( s->res & ~SL_EXT_FLAG ) ) {
+        s->res = size | SL_EXT_FLAG;
+        return s;
+    } else {
+        sl_base_p n = sl_arena_alloc( a, size );
+        memcpy( n->str, s->str, s->len + 1 );
+        n->len = s->len;
+        return n;
+    }
+}
+
+
+/**
+ * Free arena SL.
+ *
+ * Only the latest allocation is returned to arena.
+ *
+ * @param a Arena.
+ * @param s SL base.
+ */
+static void sl_arena_free( sl_arena_p a, sl_base_p s )
+{
+    char* x = (char*)sl_ext( s );
+
+    if ( x == a->last ) {
+        a->cur->used = x - a->cur->data;
+        a->last = NULL;
+    }
+}
+
+
+/**
+ * Resize SL in user storage.
+ *
+ * Enlarged SL is moved to heap. User storage can't be compacted.
+ *
+ * @param s    SL base.
+ * @param size Storage size.
+ *
+ * @return SL base (possibly moved).
+ */
+static sl_base_p sl_use_resize( sl_base_p s, sl_size_t size )
+{
+    if ( size <= ( s->res & ~SL_EXT_FLAG ) )
+        return s;
+
+    sl_base_p n = sl_heap_alloc( size );
+    memcpy( n->str, s->str, s->len + 1 );
+    n->len = s->len;
+
+    return n;
+}
+
+
+/**
+ * Resize hashable heap SL.
+ *
+ * @param s    SL base.
+ * @param size Storage size.
+ *
+ * @return SL base (possibly moved).
+ */
+static sl_base_p sl_hashable_resize( sl_base_p s, sl_size_t size )
+{
+    sl_ext_p x;
+
+    x = (sl_ext_p)sl_realloc( sl_ext( s ), sizeof( sl_ext_s ) + sl_malsize( size ) );
+    s = (sl_base_p)( x + 1 );
+    s->res = size | SL_EXT_FLAG;
+
+    return s;
+}
+
+
+/**
+ * Resize shared SL. Sole reference is resized in place, otherwise
+ * content is copied to a private heap SL and the reference is
+ * released.
+ *
+ * @param s    SL base.
+ * @param size Storage size.
+ *
+ * @return SL base (possibly moved).
+ */
+static sl_base_p sl_shared_resize( sl_base_p s, sl_size_t size )
+{
+    sl_base_p n;
+
+    if ( __atomic_load_n( &sl_ext( s )->refs, __ATOMIC_ACQUIRE ) == 1 )
+        return sl_hashable_resize( s, size );
+
+    if ( size < s->len + 1 )
+        size = s->len + 1;
+    n = sl_heap_alloc( size );
+    memcpy( n->str, s->str, s->len + 1 );
+    n->len = s->len;
+    sl_shared_free( s );
+
+    return n;
+}
+
+
+/**
+ * Release shared SL reference, and free storage with last reference.
+ *
+ * @param s SL base.
+ */
+static void sl_shared_free( sl_base_p s )
+{
+    if ( __atomic_sub_fetch( &sl_ext( s )->refs, 1, __ATOMIC_ACQ_REL ) == 0 )
+        sl_free( sl_ext( s ) );
+}
+
+
+/**
+ * Prepare SL for modification. Shared SL with other references and
+ * mapped SL are detached to private storage, and cached hash is
+ * invalidated.
+ *
+ * @param sp SLP.
+ */
+static void sl_unshare( sl_p sp )
+{
+    sl_base_p s = sl_base( *sp );
+
+    if ( !sl_is_ext( s ) )
+        return;
+
+    if ( sl_ext( s )->kind == SL_KIND_MAPPED
+         || ( sl_ext( s )->kind == SL_KIND_SHARED
+              && __atomic_load_n( &sl_ext( s )->refs, __ATOMIC_ACQUIRE ) > 1 ) ) {
+        s = sl_ext_resize( s, sl_res( *sp ) );
+        *sp = sl_str( s );
+    } else {
+        sl_ext( s )->hash = 0;
+    }
+}
+
+
+/**
+ * Invalidate cached hash of SL modified in place. Shared and mapped
+ * SLs are never modified through SL functions, and their hash may be
+ * read by other threads, hence it is kept.
+ *
+ * @param ss SL.
+ */
+static void sl_unhash( sl_t ss )
+{
+    sl_base_p s = sl_base( ss );
+
+    if ( sl_is_ext( s ) && sl_ext( s )->kind != SL_KIND_SHARED && sl_ext( s )->kind != SL_KIND_MAPPED )
+        sl_ext( s )->hash = 0;
+}
+
+
+/**
+ * Resize mapped SL, i.e. copy content to heap SL and unmap.
+ *
+ * @param s    SL base.
+ * @param size Storage size.
+ *
+ * @return SL base (heap).
+ */
+static sl_base_p sl_mapped_resize( sl_base_p s, sl_size_t size )
+{
+    sl_base_p n;
+
+    if ( size < s->len + 1 )
+        size = s->len + 1;
+    n = sl_heap_alloc( size );
+    memcpy( n->str, s->str, s->len + 1 );
+    n->len = s->len;
+    sl_mapped_free( s );
+
+    return n;
+}
+
+
+/**
+ * Unmap mapped SL. Mapping starts at the page with SL headers.
+ *
+ * @param s SL base.
+ */
+static void sl_mapped_free( sl_base_p s )
+{
+    size_t page = sysconf( _SC_PAGESIZE );
+    munmap( (char*)s->str - page, sl_ext( s )->size );
+}
+
+
+/**
+ * Return file size or (-1 on error).
+ *
+ * @param filename Name of file.
+ *
+ * @return File size.
+ */
+static off_t sl_file_size( const char* filename )
+{
+    struct stat st;
+
+    if ( stat( filename, &st ) == 0 )
+        return st.st_size;
+
+    return -1; // GCOV_EXCL_LINE
+}
+
+
+/**
+ * Normalize (possibly negative) SL index. Positive index is saturated
+ * to SL length, and negative index is normalized.
+ *
+ * -1 means last char in SL, -2 second to last, etc. Index after last
+ * char can only be expressed by positive indeces. E.g. for SL with
+ * length of 4 the indeces are:
+ *
+ * Chars:     a  b  c  d  \0
+ * Positive:  0  1  2  3  4
+ * Negative: -4 -3 -2 -1
+ *
+ * Negative index beyond start is saturated to 0.
+ *
+ * @param len SL (or view) length.
+ * @param idx Index to SL.
+ *
+ * @return Unsigned (positive) index to SL.
+ */
+static sl_size_t sl_norm_idx( sl_size_t len, sl_pos_t idx )
+{
+    sl_size_t ret;
+
+    if ( idx < 0 ) {
+        ret = ( (sl_size_t)-idx > len ) ? 0 : len + idx;
+    } else if ( (sl_size_t)idx > len ) {
+        ret = len;
+    } else {
+        ret = idx;
+    }
+
+    return ret;
+}
+
+
+/**
+ * Copy s2 to s1.
+ *
+ * @param s1   SL target.
+ * @param s2   Source string.
+ * @param len1 s2 length + 1
+ *
+ * @return SL.
+ */
+static sl_t sl_copy_base( sl_p s1, char* s2, sl_size_t len1 )
+{
+    sl_unshare( s1 );
+    if ( sl_reserve( s1, len1 ) == NULL )
+        return NULL;
+    strncpy( *s1, s2, len1 );
+    sl_len( *s1 ) = len1 - 1;
+    return *s1;
+}
+
+
+/**
+ * Convert word in memory order to big-endian number.
+ *
+ * @param w Word.
+ *
+ * @return Number.
+ */
+static inline uint64_t sl_be64( uint64_t w )
+{
+#if defined( __GNUC__ ) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap64( w );
+#elif defined( __GNUC__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return w;
+#else
+    unsigned char* b = (unsigned char*)&w;
+    uint64_t       ret = 0;
+    for ( int i = 0; i < 8; i++ )
+        ret = ( ret << 8 ) | b[ i ];
+    return ret;
+#endif
+}
+
+
+/**
+ * Load sort key, i.e. 8 bytes from "depth" as big-endian number.
+ *
+ * Key stops at string end (or null), and rest of the key is zero.
+ * Binary sort keys include nulls.
+ *
+ * @param str   String.
+ * @param depth Key position.
+ * @param flags Sort flags.
+ *
+ * @return Key.
+ */
+static uint64_t sl_sort_key( char* str, size_t depth, int flags )
+{
+    uint64_t key = 0;
+    int      i = 0;
+
+    if ( flags & SL_SORT_LEN ) {
+        size_t len = sl_len( str );
+        if ( depth + 8 <= len ) {
+            memcpy( &key, str + depth, 8 );
+            /* Wide load is valid unless there is an embedded null. */
+            if ( ( flags & SL_SORT_BINARY )
+                 || !( ( key - 0x0101010101010101ULL ) & ~key & 0x8080808080808080ULL ) ) {
+                return sl_be64( key );
+            }
+            key = 0;
+        } else if ( flags & SL_SORT_BINARY ) {
+            for ( ; depth + i < len; i++ )
+                key |= (uint64_t)(unsigned char)str[ depth + i ] << ( 56 - 8 * i );
+            return key;
+        }
+    }
+
+    /* Null terminates also SLs. */
+    str += depth;
+    while ( i < 8 && str[ i ] ) {
+        key |= (uint64_t)(unsigned char)str[ i ] << ( 56 - 8 * i );
+        i++;
+    }
+
+    return key;
+}
+
+
+/**
+ * Return sort bucket of item at "depth".
+ *
+ * Bucket 0 is for ended strings, and other buckets are for byte
+ * values plus one. Zero byte is end, unless sort is binary and
+ * string is longer.
+ *
+ * @param item  Sort item.
+ * @param depth Sort depth.
+ * @param flags Sort flags.
+ *
+ * @return Bucket.
+ */
+static inline int sl_sort_bucket( sl_sort_item_s* item, size_t depth, int flags )
+{
+    int c = ( item->key >> ( 56 - 8 * ( depth & 7 ) ) ) & 0xff;
+
+    if ( c )
+        return c + 1;
+    else if ( ( flags & SL_SORT_BINARY ) && sl_len( item->str ) > depth )
+        return 1;
+    else
+        return 0;
+}
+
+
+/**
+ * Sort items from "depth" onwards with insertion sort.
+ *
+ * @param it    Items.
+ * @param n     Item count.
+ * @param depth Sorted prefix length.
+ * @param flags Sort flags.
+ */
+static void sl_sort_insert( sl_sort_item_s* it, size_t n, size_t depth, int flags )
+{
+    for ( size_t i = 1; i < n; i++ ) {
+        sl_sort_item_s t = it[ i ];
+        size_t         j = i;
+        if ( flags & SL_SORT_BINARY ) {
+            while ( j > 0
+                    && sl_compare_bin_base( it[ j - 1 ].str + depth,
+                                            sl_len( it[ j - 1 ].str ) - depth,
+                                            t.str + depth,
+                                            sl_len( t.str ) - depth )
+                           > 0 ) {
+                it[ j ] = it[ j - 1 ];
+                j--;
+            }
+        } else {
+            while ( j > 0 && strcmp( it[ j - 1 ].str + depth, t.str + depth ) > 0 ) {
+                it[ j ] = it[ j - 1 ];
+                j--;
+            }
+        }
+        it[ j ] = t;
+    }
+}
+
+
+/**
+ * Sort items with MSD radix sort.
+ *
+ * Items are distributed to byte buckets at "depth". Ended strings
+ * are in bucket 0, and they are done. Other buckets are sorted
+ * recursively, except the largest, which is continued in the loop,
+ * hence recursion is at most log2(n) deep. Key bytes are taken from
+ * the cached key, which is re-loaded every 8 bytes.
+ *
+ * Stable sort distributes through "aux", and otherwise items are
+ * permuted in-place (American flag sort).
+ *
+ * @param it    Items.
+ * @param aux   Auxiliary items (or NULL).
+ * @param n     Item count.
+ * @param depth Sorted prefix length.
+ * @param flags Sort flags.
+ */
+static void sl_sort_radix( sl_sort_item_s* it, sl_sort_item_s* aux, size_t n, size_t depth, int flags )
+{
+    size_t cnt[ SL_SORT_BUCKETS ];
+    size_t next[ SL_SORT_BUCKETS ];
+    size_t start[ SL_SORT_BUCKETS ];
+    int    big;
+
+    while ( n > SL_SORT_INSERT ) {
+
+        if ( ( depth & 7 ) == 0 ) {
+            uint64_t diff = 0;
+            int      skip = 0;
+            for ( size_t i = 0; i < n; i++ ) {
+                it[ i ].key = sl_sort_key( it[ i ].str, depth, flags );
+                diff |= it[ i ].key ^ it[ 0 ].key;
+            }
+
+            /*
+             * Skip common prefix bytes. Zero bytes are not skipped,
+             * since they might be ends.
+             */
+            while ( skip < 8 && ( ( it[ 0 ].key >> ( 56 - 8 * skip ) ) & 0xff ) )
+                skip++;
+            if ( diff == 0 && skip < 8 && !( flags & SL_SORT_BINARY ) )
+                return;
+            if ( diff && __builtin_clzll( diff ) / 8 < skip )
+                skip = __builtin_clzll( diff ) / 8;
+            depth += skip;
+            if ( skip == 8 )
+                continue;
+        }
+
+        memset( cnt, 0, sizeof( cnt ) );
+        for ( size_t i = 0; i < n; i++ )
+            cnt[ sl_sort_bucket( &it[ i ], depth, flags ) ]++;
+
+        /* Common prefix byte, no distribution needed. */
+        if ( cnt[ sl_sort_bucket( &it[ 0 ], depth, flags ) ] == n ) {
+            if ( sl_sort_bucket( &it[ 0 ], depth, flags ) == 0 )
+                return;
+            depth++;
+            continue;
+        }
+
+        start[ 0 ] = 0;
+        for ( int b = 1; b < SL_SORT_BUCKETS; b++ )
+            start[ b ] = start[ b - 1 ] + cnt[ b - 1 ];
+        memcpy( next, start, sizeof( next ) );
+
+        if ( aux ) {
+            for ( size_t i = 0; i < n; i++ )
+                aux[ next[ sl_sort_bucket( &it[ i ], depth, flags ) ]++ ] = it[ i ];
+            memcpy( it, aux, n * sizeof( sl_sort_item_s ) );
+        } else {
+            for ( int b = 0; b < SL_SORT_BUCKETS; b++ ) {
+                size_t end = start[ b ] + cnt[ b ];
+                while ( next[ b ] < end ) {
+                    sl_sort_item_s t = it[ next[ b ] ];
+                    int            c = sl_sort_bucket( &t, depth, flags );
+                    while ( c != b ) {
+                        sl_sort_item_s u = it[ next[ c ] ];
+                        it[ next[ c ]++ ] = t;
+                        t = u;
+                        c = sl_sort_bucket( &t, depth, flags );
+                    }
+                    it[ next[ b ]++ ] = t;
+                }
+            }
+        }
+
+        big = 1;
+        for ( int b = 2; b < SL_SORT_BUCKETS; b++ )
+            if ( cnt[ b ] > cnt[ big ] )
+                big = b;
+
+        for ( int b = 1; b < SL_SORT_BUCKETS; b++ ) {
+            if ( b != big && cnt[ b ] > 1 )
+                sl_sort_radix( it + start[ b ],
+                               aux ? aux + start[ b ] : NULL,
+                               cnt[ b ],
+                               depth + 1,
+                               flags );
+        }
+
+        it += start[ big ];
+        if ( aux )
+            aux += start[ big ];
+        n = cnt[ big ];
+        depth++;
+    }
+
+    sl_sort_insert( it, n, depth, flags );
+}
+
+
+/**
+ * Compare strings with lengths.
+ *
+ * Strings up to 16 bytes are compared in (overlapping) words, and
+ * longer with memcmp.
+ *
+ * @param s1 String 1.
+ * @param l1 String 1 length.
+ * @param s2 String 2.
+ * @param l2 String 2 length.
+ *
+ * @return -1,0,1.
+ */
+static int sl_compare_bin_base( const char* s1, size_t l1, const char* s2, size_t l2 )
+{
+    size_t   n = ( l1 < l2 ) ? l1 : l2;
+    uint64_t a, b;
+    uint32_t a4, b4;
+    int      ret;
+
+    if ( n >= 8 && n <= 16 ) {
+        memcpy( &a, s1, 8 );
+        memcpy( &b, s2, 8 );
+        if ( a == b ) {
+            memcpy( &a, s1 + n - 8, 8 );
+            memcpy( &b, s2 + n - 8, 8 );
+        }
+        if ( a != b )
+            return ( sl_be64( a ) < sl_be64( b ) ) ? -1 : 1;
+    } else if ( n >= 4 && n < 8 ) {
+        memcpy( &a4, s1, 4 );
+        memcpy( &b4, s2, 4 );
+        if ( a4 == b4 ) {
+            memcpy( &a4, s1 + n - 4, 4 );
+            memcpy( &b4, s2 + n - 4, 4 );
+        }
+        if ( a4 != b4 )
+            return ( sl_be64( (uint64_t)a4 ) < sl_be64( (uint64_t)b4 ) ) ? -1 : 1;
+    } else if ( n < 4 ) {
+        for ( size_t i = 0; i < n; i++ ) {
+            if ( s1[ i ] != s2[ i ] )
+                return ( (unsigned char)s1[ i ] < (unsigned char)s2[ i ] ) ? -1 : 1;
+        }
+    } else {
+        ret = memcmp( s1, s2, n );
+        if ( ret )
+            return ( ret < 0 ) ? -1 : 1;
+    }
+
+    if ( l1 == l2 )
+        return 0;
+    else
+        return ( l1 < l2 ) ? -1 : 1;
+}
+
+
+/**
+ * Sort string array.
+ *
+ * @param sa    String array.
+ * @param len   Array length.
+ * @param flags Sort flags.
+ */
+static void sl_sort_base( char** sa, size_t len, int flags )
+{
+    sl_sort_item_s* it;
+    sl_sort_item_s* aux = NULL;
+
+    if ( len < 2 )
+        return;
+
+    it = sl_malloc( len * sizeof( sl_sort_item_s ) * ( ( flags & SL_SORT_STABLE ) ? 2 : 1 ) );
+    if ( flags & SL_SORT_STABLE )
+        aux = it + len;
+
+    for ( size_t i = 0; i < len; i++ )
+        it[ i ].str = sa[ i ];
+
+    sl_sort_radix( it, aux, len, 0, flags );
+
+    for ( size_t i = 0; i < len; i++ )
+        sa[ i ] = it[ i ].str;
+
+    sl_free( it );
+}
+
+
+/**
+ * Parallel task thread entry.
+ *
+ * Thread runs its part of each phase, and waits for the caller to
+ * start the next phase.
+ *
+ * @param arg Task thread.
+ *
+ * @return NULL.
+ */
+static void* sl_par_entry( void* arg )
+{
+    sl_par_thread_s* t = arg;
+    sl_par_s*        par = t->par;
+
+    for ( int p = 0; p < par->nfn; p++ ) {
+        par->fn[ p ]( par->arg, t->idx );
+        pthread_mutex_lock( &par->lock );
+        par->done++;
+        pthread_cond_broadcast( &par->cond );
+        while ( p + 1 < par->nfn && par->phase == p )
+            pthread_cond_wait( &par->cond, &par->lock );
+        pthread_mutex_unlock( &par->lock );
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Run task phases in parallel threads.
+ *
+ * Threads are created once, and each phase is a barrier, i.e. all
+ * threads are done with phase before next one starts. Phase task is
+ * called with thread index from 0 to "nthreads"-1. Index 0 is run by
+ * the caller, and function returns when all threads are done. If
+ * thread can't be created, its part is run by the caller.
+ *
+ * @param nthreads Thread count.
+ * @param fn       Task of each phase.
+ * @param nfn      Phase count.
+ * @param arg      Task argument.
+ */
+static void sl_par_run( int nthreads, sl_par_fn_t* fn, int nfn, void* arg )
+{
+    sl_par_thread_s thr[ SL_SORT_THREADS_MAX ];
+    int             ok[ SL_SORT_THREADS_MAX ];
+    sl_par_s        par;
+    int             created = 0;
+
+    par.fn = fn;
+    par.nfn = nfn;
+    par.arg = arg;
+    par.phase = 0;
+    par.done = 0;
+    pthread_mutex_init( &par.lock, NULL );
+    pthread_cond_init( &par.cond, NULL );
+
+    for ( int i = 1; i < nthreads; i++ ) {
+        thr[ i ].par = &par;
+        thr[ i ].idx = i;
+        ok[ i ] = ( pthread_create( &thr[ i ].thr, NULL, sl_par_entry, &thr[ i ] ) == 0 );
+        created += ok[ i ];
+    }
+
+    for ( int p = 0; p < nfn; p++ ) {
+        fn[ p ]( arg, 0 );
+        for ( int i = 1; i < nthreads; i++ ) {
+            if ( !ok[ i ] )
+                fn[ p ]( arg, i ); // GCOV_EXCL_LINE
+        }
+        pthread_mutex_lock( &par.lock );
+        while ( par.done < created )
+            pthread_cond_wait( &par.cond, &par.lock );
+        par.done = 0;
+        par.phase++;
+        pthread_cond_broadcast( &par.cond );
+        pthread_mutex_unlock( &par.lock );
+    }
+
+    for ( int i = 1; i < nthreads; i++ ) {
+        if ( ok[ i ] )
+            pthread_join( thr[ i ].thr, NULL );
+    }
+
+    pthread_cond_destroy( &par.cond );
+    pthread_mutex_destroy( &par.lock );
+}
+
+
+/**
+ * Classify thread's part of parallel sort strings to buckets.
+ *
+ * With "k" as the number of splitters less than string, bucket is
+ * 2*k+1 if string equals to splitter "k", and 2*k otherwise. Equal
+ * splitters leave empty buckets.
+ *
+ * @param arg Parallel sort.
+ * @param idx Thread index.
+ */
+static void sl_psort_classify( void* arg, int idx )
+{
+    sl_psort_s* ps = arg;
+    size_t      a = ps->len * idx / ps->nthr;
+    size_t      b = ps->len * ( idx + 1 ) / ps->nthr;
+    size_t*     cnt = ps->cnt + idx * ps->nbkt;
+
+    memset( cnt, 0, ps->nbkt * sizeof( size_t ) );
+
+    for ( size_t i = a; i < b; i++ ) {
+        int lo = 0, hi = ps->nthr - 1, eq = 0;
+        while ( lo < hi ) {
+            int mid = ( lo + hi ) / 2;
+            int cmp = strcmp( ps->split[ mid ], ps->sa[ i ] );
+            if ( cmp < 0 ) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+                eq = ( cmp == 0 );
+            }
+        }
+        ps->bkt[ i ] = 2 * lo + eq;
+        cnt[ 2 * lo + eq ]++;
+    }
+}
+
+
+/**
+ * Scatter thread's part of parallel sort strings to buckets.
+ *
+ * Buckets are in order, and within bucket, parts are in thread
+ * order.
+ *
+ * @param arg Parallel sort.
+ * @param idx Thread index.
+ */
+static void sl_psort_scatter( void* arg, int idx )
+{
+    sl_psort_s* ps = arg;
+    size_t      a = ps->len * idx / ps->nthr;
+    size_t      b = ps->len * ( idx + 1 ) / ps->nthr;
+    size_t      pos[ 2 * SL_SORT_THREADS_MAX ];
+    size_t      off = 0;
+
+    for ( int k = 0; k < ps->nbkt; k++ ) {
+        for ( int t = 0; t < ps->nthr; t++ ) {
+            if ( t == idx )
+                pos[ k ] = off;
+            off += ps->cnt[ t * ps->nbkt + k ];
+        }
+    }
+
+    for ( size_t i = a; i < b; i++ )
+        ps->out[ pos[ ps->bkt[ i ] ]++ ] = ps->sa[ i ];
+}
+
+
+/**
+ * Sort parallel sort bucket and copy it back to array.
+ *
+ * Thread sorts bucket 2*idx, and copies also the following equality
+ * bucket, which is sorted already.
+ *
+ * @param arg Parallel sort.
+ * @param idx Thread index.
+ */
+static void sl_psort_bucket( void* arg, int idx )
+{
+    sl_psort_s* ps = arg;
+    int         k0 = 2 * idx;
+    int         k1 = ( k0 + 1 < ps->nbkt ) ? k0 + 1 : k0;
+    size_t      a = 0;
+    size_t      n = 0;
+    size_t      m = 0;
+
+    for ( int t = 0; t < ps->nthr; t++ ) {
+        size_t* cnt = ps->cnt + t * ps->nbkt;
+        for ( int k = 0; k < k0; k++ )
+            a += cnt[ k ];
+        n += cnt[ k0 ];
+        if ( k1 != k0 )
+            m += cnt[ k1 ];
+    }
+
+    sl_sort_base( ps->out + a, n, ps->flags );
+    memcpy( ps->sa + a, ps->out + a, ( n + m ) * sizeof( char* ) );
+}
+
+
+/**
+ * Concatenate s2 to s1.
+ *
+ * @param s1   SL target.
+ * @param s2   Source string.
+ * @param len1 s2 length + 1.
+ *
+ * @return SL.
+ */
+static sl_t sl_concatenate_base( sl_p s1, char* s2, sl_size_t len1 )
+{
+    sl_unshare( s1 );
+
+    if ( sl_within( *s1, s2 ) ) {
+        /* Self append, s2 moves with s1. */
+        size_t off = s2 - *s1;
+        if ( sl_grow( s1, (uint64_t)sl_len( *s1 ) + len1 ) == NULL )
+            return NULL;
+        s2 = *s1 + off;
+    } else if ( sl_grow( s1, (uint64_t)sl_len( *s1 ) + len1 ) == NULL ) {
+        return NULL;
+    }
+
+    /* Terminate separately, since self append overwrites s2 null. */
+    memcpy( sl_end( *s1 ), s2, len1 - 1 );
+    sl_len( *s1 ) += len1 - 1;
+    *sl_end( *s1 ) = 0;
+    return *s1;
+}
+
+
+/**
+ * Insert s2 of with length+1 to s1 into position pos.
+ *
+ * @param s1    String 1.
+ * @param pos   Insert position.
+ * @param s2    String 2.
+ * @param len1  s2 length + 1.
+ *
+ * @return SL.
+ */
+static sl_t sl_insert_base( sl_p s1, sl_pos_t pos, char* s2, sl_size_t len1 )
+{
+    char* tmp = NULL;
+
+    sl_unshare( s1 );
+
+    if ( sl_within( *s1, s2 ) ) {
+        /* Self insert, s2 would be both moved and shifted. */
+        tmp = sl_malloc( len1 );
+        memcpy( tmp, s2, len1 );
+        s2 = tmp;
+    }
+
+    if ( sl_grow( s1, (uint64_t)sl_len( *s1 ) + len1 ) == NULL ) {
+        if ( tmp )
+            sl_free( tmp );
+        return NULL;
+    }
+
+    len1--;
+
+    sl_size_t posn = sl_norm_idx( sl_len( *s1 ), pos );
+
+    /*
+     *          tail
+     *         /
+     * abcd....efghi
+     */
+
+    sl_size_t tail = posn + len1;
+
+    memmove( ( *s1 ) + tail, ( *s1 ) + posn, ( sl_len( *s1 ) - posn ) );
+    strncpy( ( *s1 ) + posn, s2, len1 );
+    sl_len( *s1 ) += len1;
+
+    /* Terminate change SL. */
+    sl_base_p s = sl_base( *s1 );
+    s->str[ s->len ] = 0;
+
+    if ( tmp )
+        sl_free( tmp );
+
+    return *s1;
+}
+
+
+/**
+ * Divide SL by replacing "c" with 0. Count the number of segments and
+ * assign "div" to point to start of each segment.
+ *
+ * If size is less than 0, count only the number of segments.
+ *
+ * @param ss   SL.
+ * @param c    Division char.
+ * @param size Segment limit (size of div).
+ * @param div  Storage for segments.
+ *
+ * @return Number of segments.
+ */
+static int sl_divide_base( sl_t ss, char c, int size, char** div )
+{
+    int   divcnt = 0;
+    char *a, *b;
+
+    if ( size >= 0 )
+        sl_unhash( ss );
+
+    a = ss;
+    b = ss;
+
+    while ( *b ) {
+        if ( *b == c ) {
+            if ( size >= 0 )
+                *b = 0;
+            if ( divcnt < size ) {
+                div[ divcnt ] = a;
+                a = b + 1;
+            }
+            divcnt++;
+        }
+        b++;
+    }
+
+    if ( divcnt < size && size >= 0 )
+        div[ divcnt ] = a;
+
+    return divcnt + 1;
+}
+
+
+/**
+ * Segment SL by replacing pattern with 0. Count the number of
+ * segments and assign "div" to point to start of each segment.
+ *
+ * If size is less than 0, count only the number of segments.
+ *
+ * @param ss   SL.
+ * @param pat  Pattern to split with.
+ * @param size Segment limit (size of div).
+ * @param div  Storage for segments.
+ *
+ * @return Number of segments.
+ */
+static int sl_segment_base( sl_t ss, sl_pattern_p pat, int size, char** div )
+{
+    int      divcnt = 0;
+    sl_pos_t idx;
+    size_t   len = pat->nlen;
+    char *   a, *b;
+
+    if ( size >= 0 )
+        sl_unhash( ss );
+
+    a = ss;
+    b = ss;
+
+    while ( *a ) {
+        idx = sl_pattern_base( pat, a, sl_end( ss ) - a );
+        if ( idx >= 0 ) {
+            b = a + idx;
+            if ( size >= 0 )
+                *b = 0;
+            if ( divcnt < size ) {
+                div[ divcnt ] = a;
+            }
+            b += len;
+            a = b;
+            divcnt++;
+        } else {
+            break;
+        }
+    }
+
+    if ( divcnt < size && size >= 0 )
+        div[ divcnt ] = a;
+
+    return divcnt + 1;
+}
+
+
+/**
+ * Segment SL with pattern and allocate "div" if needed.
+ *
+ * See sl_segment_with_str() for "size" and "div" usage.
+ *
+ * @param ss   SL.
+ * @param pat  Pattern to split with.
+ * @param size Size of div storage (-1 for na).
+ * @param div  Address of div storage.
+ *
+ * @return Number of pieces.
+ */
+static int sl_segment_alloc( sl_t ss, sl_pattern_p pat, int size, char*** div )
+{
+    if ( size < 0 ) {
+        /* Just count size, don't replace chars. */
+        return sl_segment_base( ss, pat, -1, NULL );
+    } else if ( *div ) {
+        /* Use pre-allocated storage. */
+        return sl_segment_base( ss, pat, size, *div );
+    } else {
+        /* Calculate size and allocate storage. */
+        size = sl_segment_base( ss, pat, -1, NULL );
+        *div = (char**)sl_malloc( size * sizeof( char* ) );
+        return sl_segment_base( ss, pat, size, *div );
+    }
+}
+
+
+/**
+ * Map (replace) pattern to "t" in SL.
+ *
+ * @param sp  SLP.
+ * @param pat Pattern to replace.
+ * @param t   Replacement.
+ *
+ * @return SL.
+ */
+static sl_t sl_map_base( sl_p sp, sl_pattern_p pat, char* t )
+{
+    /*
+     * If "t" is longer than "f", loop and count how many instances of
+     * "f" is found. Increase size of sp by N*t.len - N*f.len.
+     *
+     * Loop and find the next "f" index. Skip upto index and insert "t"
+     * inplace. Continue until "f" is no more found and insert tail of
+     * "sp".
+     */
+
+    sl_size_t f_len = pat->nlen;
+    sl_size_t t_len = sc_len( t );
+
+    sl_pos_t idx;
+    char *   a, *b, *e;
+
+    sl_unshare( sp );
+
+    if ( t_len > f_len ) {
+        /* Calculate number of parts. */
+        sl_size_t cnt = 0;
+
+        /*
+         * Replace XXX with YYYY.
+         *
+         * foooXXXfiiiXXXdiii
+         * foooYYYYfiiiYYYYdiii
+         *
+         * Prepare org before copy as:
+         * --foooXXXfiiiXXXdiii
+         *
+         *   OR
+         *
+         * foooXXXfiiiXXXdiiiXXX
+         * foooYYYYfiiiYYYYdiiiYYYY
+         */
+        a = *sp;
+        e = sl_end( *sp );
+
+        while ( 1 ) {
+            idx = sl_pattern_base( pat, a, e - a );
+            if ( idx >= 0 ) {
+                cnt++;
+                a += ( idx + f_len );
+            } else {
+                break;
+            }
+        }
+
+        sl_size_t nlen;
+        sl_size_t olen = sl_len( *sp );
+        uint64_t  size = (uint64_t)olen - (uint64_t)cnt * f_len + (uint64_t)cnt * t_len + 1;
+        if ( sl_grow( sp, size ) == NULL )
+            return NULL;
+        nlen = size - 1;
+        sl_len( *sp ) = nlen;
+
+        /*
+         * Shift original sp content to right in order to enable copying
+         * chars safely from right to left.
+         */
+        b = &( ( *sp )[ nlen - olen ] );
+        memmove( b, *sp, olen + 1 );
+        a = *sp;
+        e = sl_end( *sp );
+    } else {
+        /*
+         * Replace XXX with YY.
+         *
+         * foooXXXfiiiXXXdiii
+         * foooYYfiiiYYdiii
+         */
+        a = *sp;
+        b = *sp;
+        e = sl_end( *sp );
+    }
+
+    while ( b < e ) {
+        idx = sl_pattern_base( pat, b, e - b );
+        if ( idx >= 0 ) {
+            memmove( a, b, idx );
+            a += idx;
+            memcpy( a, t, t_len );
+            a += t_len;
+            b += ( idx + f_len );
+        } else {
+            memmove( a, b, e - b );
+            a += e - b;
+            break;
+        }
+    }
+
+    *a = 0;
+    sl_len( *sp ) = a - *sp;
+
+    return *sp;
+}
+
+
+/**
+ * Find needle from haystack. Return position or -1 if not found.
+ *
+ * Candidate positions are filtered by comparing the first and the
+ * last needle char to haystack in parallel (SSE2/AVX2), and only
+ * candidates are compared fully. Without SIMD, memchr is used to
+ * locate candidates.
+ *
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param ndl  Needle.
+ * @param nlen Needle length.
+ *
+ * @return Pos (or -1 if not found).
+ */
+static sl_pos_t sl_find_base( const char* hay, size_t hlen, const char* ndl, size_t nlen )
+{
+    if ( nlen == 0 || nlen > hlen )
+        return -1;
+
+    if ( nlen == 1 ) {
+        const char* p = memchr( hay, ndl[ 0 ], hlen );
+        return p ? p - hay : -1;
+    }
+
+    /* Last possible match position. */
+    size_t last = hlen - nlen;
+    size_t i = 0;
+
+#if defined( __AVX2__ )
+
+    __m256i vf32 = _mm256_set1_epi8( ndl[ 0 ] );
+    __m256i vl32 = _mm256_set1_epi8( ndl[ nlen - 1 ] );
+
+    for ( ; i + 32 <= last + 1; i += 32 ) {
+        __m256i  bf = _mm256_loadu_si256( (const __m256i*)( hay + i ) );
+        __m256i  bl = _mm256_loadu_si256( (const __m256i*)( hay + i + nlen - 1 ) );
+        uint32_t mask = _mm256_movemask_epi8(
+            _mm256_and_si256( _mm256_cmpeq_epi8( vf32, bf ), _mm256_cmpeq_epi8( vl32, bl ) ) );
+        while ( mask ) {
+            size_t bit = __builtin_ctz( mask );
+            if ( memcmp( hay + i + bit + 1, ndl + 1, nlen - 2 ) == 0 )
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+#endif
+
+#if defined( __SSE2__ )
+
+    __m128i vf16 = _mm_set1_epi8( ndl[ 0 ] );
+    __m128i vl16 = _mm_set1_epi8( ndl[ nlen - 1 ] );
+
+    for ( ; i + 16 <= last + 1; i += 16 ) {
+        __m128i  bf = _mm_loadu_si128( (const __m128i*)( hay + i ) );
+        __m128i  bl = _mm_loadu_si128( (const __m128i*)( hay + i + nlen - 1 ) );
+        uint32_t mask =
+            _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi8( vf16, bf ), _mm_cmpeq_epi8( vl16, bl ) ) );
+        while ( mask ) {
+            size_t bit = __builtin_ctz( mask );
+            if ( memcmp( hay + i + bit + 1, ndl + 1, nlen - 2 ) == 0 )
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+#endif
+
+    while ( i <= last ) {
+        const char* p = memchr( hay + i, ndl[ 0 ], last - i + 1 );
+        if ( p == NULL )
+            return -1;
+        i = p - hay;
+        if ( hay[ i + nlen - 1 ] == ndl[ nlen - 1 ]
+             && memcmp( hay + i + 1, ndl + 1, nlen - 2 ) == 0 )
+            return i;
+        i++;
+    }
+
+    return -1;
+}
+
+
+/**
+ * Find char from haystack, starting from the end. Return position
+ * or -1 if not found.
+ *
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param c    Char.
+ *
+ * @return Pos (or -1 if not found).
+ */
+static sl_pos_t sl_rchr_base( const char* hay, size_t hlen, char c )
+{
+#if defined( __AVX2__ )
+
+    __m256i v32 = _mm256_set1_epi8( c );
+
+    for ( ; hlen >= 32; hlen -= 32 ) {
+        uint32_t mask = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8( v32, _mm256_loadu_si256( (const __m256i*)( hay + hlen - 32 ) ) ) );
+        if ( mask )
+            return hlen - 32 + 31 - __builtin_clz( mask );
+    }
+
+#endif
+
+#if defined( __SSE2__ )
+
+    __m128i v16 = _mm_set1_epi8( c );
+
+    for ( ; hlen >= 16; hlen -= 16 ) {
+        uint32_t mask =
+            _mm_movemask_epi8( _mm_cmpeq_epi8( v16, _mm_loadu_si128( (const __m128i*)( hay + hlen - 16 ) ) ) );
+        if ( mask )
+            return hlen - 16 + 31 - __builtin_clz( mask );
+    }
+
+#endif
+
+    while ( hlen > 0 ) {
+        hlen--;
+        if ( hay[ hlen ] == c )
+            return hlen;
+    }
+
+    return -1;
+}
+
+
+/**
+ * Store position to index storage.
+ *
+ * With "grow", storage is allocated and enlarged as needed,
+ * otherwise positions beyond "size" are dropped.
+ *
+ * @param idx  Address of index storage.
+ * @param size Size of index storage.
+ * @param grow Grow storage.
+ * @param cnt  Position count (before this).
+ * @param pos  Position.
+ */
+static void sl_index_put( sl_pos_t** idx, sl_size_t* size, int grow, sl_size_t cnt, sl_pos_t pos )
+{
+    if ( cnt >= *size ) {
+        if ( !grow )
+            return;
+        *size = *size ? 2 * *size : 64;
+        *idx = sl_realloc( *idx, *size * sizeof( sl_pos_t ) );
+    }
+
+    ( *idx )[ cnt ] = pos;
+}
+
+
+/**
+ * Find pattern from haystack. Return position or -1 if not found.
+ *
+ * Pattern with skip table uses Horspool search, and plain pattern
+ * uses sl_find_base().
+ *
+ * @param pat  Pattern.
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ *
+ * @return Pos (or -1 if not found).
+ */
+static sl_pos_t sl_pattern_base( sl_pattern_p pat, const char* hay, size_t hlen )
+{
+    if ( pat->skip == NULL )
+        return sl_find_base( hay, hlen, pat->ndl, pat->nlen );
+
+    size_t      nlen = pat->nlen;
+    size_t      last = nlen - 1;
+    const char* ndl = pat->ndl;
+    size_t      i = 0;
+
+    while ( i + nlen <= hlen ) {
+        unsigned char c = hay[ i + last ];
+        if ( c == (unsigned char)ndl[ last ] && memcmp( hay + i, ndl, last ) == 0 )
+            return i;
+        i += pat->skip[ c ];
+    }
+
+    return -1;
+}
+
+
+/**
+ * Build Aho-Corasick automaton for patterns.
+ *
+ * Automaton is a trie with sibling lists, and failure links which
+ * point to the longest proper suffix present in the trie. Node
+ * output is the longest pattern, which is a suffix of the node
+ * path. Node 0 is root. Empty patterns are ignored.
+ *
+ * @param pats Patterns.
+ * @param plen Pattern lengths.
+ * @param n    Pattern count.
+ *
+ * @return Automaton (nodes).
+ */
+static sl_ac_node_p sl_ac_build( char** pats, size_t* plen, sl_size_t n )
+{
+    size_t total = 1;
+    for ( sl_size_t i = 0; i < n; i++ )
+        total += plen[ i ];
+
+    sl_ac_node_p ac = sl_malloc( total * sizeof( sl_ac_node_s ) );
+    int32_t      cnt = 1;
+
+    ac[ 0 ].child = -1;
+    ac[ 0 ].next = -1;
+    ac[ 0 ].fail = 0;
+    ac[ 0 ].out = -1;
+    ac[ 0 ].depth = 0;
+    ac[ 0 ].c = 0;
+
+    /* Trie. */
+    for ( sl_size_t i = 0; i < n; i++ ) {
+        int32_t node = 0;
+        for ( size_t j = 0; j < plen[ i ]; j++ ) {
+            unsigned char c = pats[ i ][ j ];
+            int32_t       k = ac[ node ].child;
+            while ( k >= 0 && ac[ k ].c != c )
+                k = ac[ k ].next;
+            if ( k < 0 ) {
+                k = cnt++;
+                ac[ k ].child = -1;
+                ac[ k ].next = ac[ node ].child;
+                ac[ k ].fail = 0;
+                ac[ k ].out = -1;
+                ac[ k ].depth = ac[ node ].depth + 1;
+                ac[ k ].c = c;
+                ac[ node ].child = k;
+            }
+            node = k;
+        }
+        if ( node != 0 && ac[ node ].out < 0 )
+            ac[ node ].out = i;
+    }
+
+    /* Failure links in breadth first order. */
+    int32_t* queue = sl_malloc( cnt * sizeof( int32_t ) );
+    int32_t  head = 0;
+    int32_t  tail = 0;
+
+    for ( int32_t k = ac[ 0 ].child; k >= 0; k = ac[ k ].next )
+        queue[ tail++ ] = k;
+
+    while ( head < tail ) {
+        int32_t node = queue[ head++ ];
+        for ( int32_t k = ac[ node ].child; k >= 0; k = ac[ k ].next ) {
+            ac[ k ].fail = sl_ac_child( ac, ac[ node ].fail, ac[ k ].c );
+            if ( ac[ k ].out < 0 )
+                ac[ k ].out = ac[ ac[ k ].fail ].out;
+            queue[ tail++ ] = k;
+        }
+    }
+
+    sl_free( queue );
+
+    return ac;
+}
+
+
+/**
+ * Return next automaton node for char, following failure links.
+ *
+ * @param ac   Automaton.
+ * @param node Current node.
+ * @param c    Char.
+ *
+ * @return Next node.
+ */
+static int32_t sl_ac_child( sl_ac_node_p ac, int32_t node, unsigned char c )
+{
+    while ( 1 ) {
+        for ( int32_t k = ac[ node ].child; k >= 0; k = ac[ k ].next ) {
+            if ( ac[ k ].c == c )
+                return k;
+        }
+        if ( node == 0 )
+            return 0;
+        node = ac[ node ].fail;
+    }
+}
+
+
+/**
+ * Add fragment to builder.
+ *
+ * @param b Builder.
+ *
+ * @return Fragment.
+ */
+static sl_frag_s* sl_builder_frag( sl_builder_t* b )
+{
+    if ( b->cnt == b->size ) {
+        sl_frag_s* frag = sl_malloc( 2 * b->size * sizeof( sl_frag_s ) );
+        memcpy( frag, b->frag, b->cnt * sizeof( sl_frag_s ) );
+        if ( b->frag != b->frag_buf )
+            sl_free( b->frag );
+        b->frag = frag;
+        b->size *= 2;
+    }
+
+    return &b->frag[ b->cnt++ ];
+}
+
+
+/**
+ * Reserve builder local data for fragment.
+ *
+ * Local data is referred by offset, since data storage may be
+ * moved. Consecutive local data is combined to one fragment.
+ *
+ * @param b   Builder.
+ * @param len Data length.
+ *
+ * @return Data storage.
+ */
+static char* sl_builder_data( sl_builder_t* b, sl_size_t len )
+{
+    /* Space for terminating null from number conversion. */
+    if ( b->dlen + len + 1 > b->dsize ) {
+        sl_size_t size = 2 * ( b->dsize + len );
+        char*     data = sl_malloc( size );
+        memcpy( data, b->data, b->dlen );
+        if ( b->data != b->data_buf )
+            sl_free( b->data );
+        b->data = data;
+        b->dsize = size;
+    }
+
+    sl_frag_s* f = b->cnt > 0 ? &b->frag[ b->cnt - 1 ] : NULL;
+    if ( f && f->ptr == NULL && f->off + f->len == b->dlen ) {
+        f->len += len;
+    } else {
+        f = sl_builder_frag( b );
+        f->ptr = NULL;
+        f->off = b->dlen;
+        f->len = len;
+    }
+
+    char* p = b->data + b->dlen;
+    b->dlen += len;
+    b->len += len;
+
+    return p;
+}
+
+
+/**
+ * Copy builder content to "dst".
+ *
+ * @param b   Builder.
+ * @param dst Destination.
+ */
+static void sl_builder_copy( sl_builder_t* b, char* dst )
+{
+    for ( sl_size_t i = 0; i < b->cnt; i++ ) {
+        sl_frag_s* f = &b->frag[ i ];
+        memcpy( dst, f->ptr ? f->ptr : b->data + f->off, f->len );
+        dst += f->len;
+    }
+}
+
+
+/**
+ * Parse Quick Format conversion spec.
+ *
+ * @param c    Format after '%'.
+ * @param spec Parsed spec.
+ *
+ * @return Format after conversion.
+ */
+static char* sl_fmt_parse( char* c, sl_fmt_spec_s* spec )
+{
+    spec->flags = 0;
+    spec->width = 0;
+    spec->prec = -1;
+
+    while ( 1 ) {
+        if ( *c == '-' )
+            spec->flags |= SL_FMT_LEFT;
+        else if ( *c == '0' )
+            spec->flags |= SL_FMT_ZERO;
+        else
+            break;
+        c++;
+    }
+
+    while ( *c >= '0' && *c <= '9' )
+        spec->width = spec->width * 10 + ( *c++ - '0' );
+
+    if ( *c == '.' ) {
+        c++;
+        spec->prec = 0;
+        while ( *c >= '0' && *c <= '9' )
+            spec->prec = spec->prec * 10 + ( *c++ - '0' );
+        if ( spec->prec > SL_FMT_PREC_MAX )
+            spec->prec = SL_FMT_PREC_MAX;
+    }
+
+    if ( *c == 'l' ) {
+        spec->flags |= SL_FMT_LONG;
+        c++;
+    }
+
+    spec->conv = *c;
+    if ( *c )
+        c++;
+
+    return c;
+}
+
+
+/**
+ * Fetch Quick Format conversion argument.
+ *
+ * Negative numbers are stored as magnitude and sign.
+ *
+ * @param spec Conversion spec.
+ * @param ap   Arguments.
+ * @param arg  Fetched argument.
+ */
+static void sl_fmt_fetch( sl_fmt_spec_s* spec, va_list* ap, sl_fmt_arg_s* arg )
+{
+    int64_t i64;
+
+    arg->sign = 0;
+    arg->text = NULL;
+
+    switch ( spec->conv ) {
+
+        case 's':
+        case 'S': {
+            arg->v.s = va_arg( *ap, char* );
+            break;
+        }
+
+        case 'c': {
+            arg->v.c = (char)va_arg( *ap, int );
+            break;
+        }
+
+        case 'i':
+        case 'd':
+        case 'I': {
+            if ( spec->conv == 'I' || ( spec->flags & SL_FMT_LONG ) )
+                i64 = va_arg( *ap, int64_t );
+            else
+                i64 = va_arg( *ap, int );
+            if ( i64 < 0 ) {
+                arg->sign = '-';
+                arg->v.u = 0 - (uint64_t)i64;
+            } else {
+                arg->v.u = i64;
+            }
+            break;
+        }
+
+        case 'u':
+        case 'U':
+        case 'x':
+        case 'X': {
+            if ( spec->conv == 'U' || ( spec->flags & SL_FMT_LONG ) )
+                arg->v.u = va_arg( *ap, uint64_t );
+            else
+                arg->v.u = va_arg( *ap, unsigned int );
+            break;
+        }
+
+        case 'f':
+        case 'g': {
+            arg->v.d = va_arg( *ap, double );
+            if ( signbit( arg->v.d ) ) {
+                arg->sign = '-';
+                arg->v.d = -arg->v.d;
+            }
+            break;
+        }
+
+        default: {
+            /* Literal char, no argument. */
+            break;
+        }
+    }
+}
+
+
+/**
+ * Output Quick Format conversion.
+ *
+ * If "wp" is NULL, only the conversion length is returned.
+ *
+ * @param spec Conversion spec.
+ * @param arg  Fetched argument.
+ * @param wp   Write pointer (or NULL).
+ *
+ * @return Conversion length.
+ */
+static sl_size_t sl_fmt_put( sl_fmt_spec_s* spec, sl_fmt_arg_s* arg, char* wp )
+{
+    char        buf[ SL_FMT_BUF ];
+    const char* body = buf;
+    sl_size_t   blen;
+    int         sign = arg->sign;
+    int         num = 0;
+
+    switch ( spec->conv ) {
+
+        case 's': {
+            body = arg->v.s;
+            blen = strlen( body );
+            break;
+        }
+
+        case 'S': {
+            body = arg->v.s;
+            blen = sl_len( body );
+            break;
+        }
+
+        case 'c': {
+            buf[ 0 ] = arg->v.c;
+            blen = 1;
+            break;
+        }
+
+        case 'i':
+        case 'd':
+        case 'I':
+        case 'u':
+        case 'U': {
+            blen = sl_u64_str_len( arg->v.u );
+            if ( wp )
+                sl_u64_to_str( arg->v.u, buf );
+            num = 1;
+            break;
+        }
+
+        case 'x':
+        case 'X': {
+            blen = ( 64 - __builtin_clzll( arg->v.u | 1 ) + 3 ) / 4;
+            if ( wp )
+                sl_u64_to_hex( arg->v.u, buf, blen, spec->conv == 'X' );
+            num = 1;
+            break;
+        }
+
+        case 'f':
+        case 'g': {
+            if ( arg->text ) {
+                body = arg->text;
+                blen = arg->tlen;
+            } else {
+                blen = sl_dbl_to_str( arg->v.d, spec, buf );
+            }
+            num = isfinite( arg->v.d );
+            break;
+        }
+
+        default: {
+            /* Literal char, including '%'. */
+            buf[ 0 ] = spec->conv;
+            blen = spec->conv ? 1 : 0;
+            break;
+        }
+    }
+
+    /* Padding to field width. */
+    sl_size_t total = blen + ( sign ? 1 : 0 );
+    sl_size_t pad = ( (sl_size_t)spec->width > total ) ? spec->width - total : 0;
+
+    if ( wp == NULL )
+        return total + pad;
+
+    if ( pad && !( spec->flags & SL_FMT_LEFT ) && !( num && ( spec->flags & SL_FMT_ZERO ) ) ) {
+        memset( wp, ' ', pad );
+        wp += pad;
+    }
+    if ( sign )
+        *wp++ = sign;
+    if ( pad && !( spec->flags & SL_FMT_LEFT ) && num && ( spec->flags & SL_FMT_ZERO ) ) {
+        memset( wp, '0', pad );
+        wp += pad;
+    }
+    memcpy( wp, body, blen );
+    wp += blen;
+    if ( pad && ( spec->flags & SL_FMT_LEFT ) )
+        memset( wp, ' ', pad );
+
+    return total + pad;
+}
+
+
+/**
+ * Perform Quick Format conversion.
+ *
+ * Conversion argument is taken from "ap". If "wp" is NULL, only the
+ * conversion length is returned.
+ *
+ * @param spec Conversion spec.
+ * @param ap   Arguments.
+ * @param wp   Write pointer (or NULL).
+ *
+ * @return Conversion length.
+ */
+static sl_size_t sl_fmt_conv( sl_fmt_spec_s* spec, va_list* ap, char* wp )
+{
+    sl_fmt_arg_s arg;
+
+    sl_fmt_fetch( spec, ap, &arg );
+
+    return sl_fmt_put( spec, &arg, wp );
+}
+
+
+/**
+ * Convert non-negative double to string.
+ *
+ * Without precision, the shortest digit sequence that converts back
+ * to the same double is used. "%f" uses plain decimal notation, and
+ * "%g" uses exponent notation for very small and large values. With
+ * precision, "%f" has the given number of decimals, which are
+ * correctly rounded.
+ *
+ * @param d    Double.
+ * @param spec Conversion spec.
+ * @param str  Storage for conversion (SL_FMT_BUF).
+ *
+ * @return Length.
+ */
+static sl_size_t sl_dbl_to_str( double d, sl_fmt_spec_s* spec, char* str )
+{
+    char  dig[ SL_FMT_BUF ];
+    int   n, k;
+    char* p = str;
+
+    if ( isnan( d ) ) {
+        memcpy( str, "nan", 3 );
+        return 3;
+    } else if ( isinf( d ) ) {
+        memcpy( str, "inf", 3 );
+        return 3;
+    }
+
+    if ( spec->conv == 'f' && spec->prec >= 0 ) {
+
+        /* Fixed decimals, "k" integer digits. */
+        n = sl_dtoa_fixed( d, spec->prec, dig, &k );
+
+        if ( k <= 0 ) {
+            *p++ = '0';
+        } else {
+            memcpy( p, dig, k );
+            p += k;
+        }
+        if ( spec->prec > 0 ) {
+            *p++ = '.';
+            for ( int i = k; i < k + spec->prec; i++ )
+                *p++ = ( i >= 0 && i < n ) ? dig[ i ] : '0';
+        }
+
+        return p - str;
+    }
+
+    /* Shortest, value is 0.DIG * 10^k. */
+    n = sl_dtoa_shortest( d, dig, &k );
+
+    if ( spec->conv == 'g' && ( k - 1 < -4 || k - 1 >= 16 ) ) {
+
+        int x = k - 1;
+
+        *p++ = dig[ 0 ];
+        if ( n > 1 ) {
+            *p++ = '.';
+            memcpy( p, dig + 1, n - 1 );
+            p += n - 1;
+        }
+        *p++ = 'e';
+        if ( x < 0 ) {
+            *p++ = '-';
+            x = -x;
+        } else {
+            *p++ = '+';
+        }
+        if ( x < 10 )
+            *p++ = '0';
+        sl_u64_to_str( x, p );
+        p += sl_u64_str_len( x );
+
+    } else if ( k <= 0 ) {
+
+        /* 0.000DIG */
+        *p++ = '0';
+        *p++ = '.';
+        memset( p, '0', -k );
+        p += -k;
+        memcpy( p, dig, n );
+        p += n;
+
+    } else if ( k < n ) {
+
+        /* DI.G */
+        memcpy( p, dig, k );
+        p += k;
+        *p++ = '.';
+        memcpy( p, dig + k, n - k );
+        p += n - k;
+
+    } else {
+
+        /* DIG000 */
+        memcpy( p, dig, n );
+        p += n;
+        memset( p, '0', k - n );
+        p += k - n;
+    }
+
+    return p - str;
+}
+
+
+/**
+ * Set bignum to u64 value.
+ *
+ * @param b   Bignum.
+ * @param u64 Value.
+ */
+static void sl_big_set( sl_big_p b, uint64_t u64 )
+{
+    b->n = 0;
+    while ( u64 ) {
+        b->w[ b->n++ ] = (uint32_t)u64;
+        u64 >>= 32;
+    }
+}
+
+
+/**
+ * Multiply bignum by 2^n.
+ *
+ * @param b Bignum.
+ * @param n Exponent.
+ */
+static void sl_big_shl( sl_big_p b, int n )
+{
+    int words = n / 32;
+    int bits = n % 32;
+
+    if ( b->n == 0 )
+        return;
+
+    if ( bits ) {
+        uint32_t carry = 0;
+        for ( int i = 0; i < b->n; i++ ) {
+            uint32_t w = b->w[ i ];
+            b->w[ i ] = ( w << bits ) | carry;
+            carry = w >> ( 32 - bits );
+        }
+        if ( carry )
+            b->w[ b->n++ ] = carry;
+    }
+
+    if ( words ) {
+        memmove( b->w + words, b->w, b->n * sizeof( uint32_t ) );
+        memset( b->w, 0, words * sizeof( uint32_t ) );
+        b->n += words;
+    }
+}
+
+
+/**
+ * Multiply bignum by small value.
+ *
+ * @param b Bignum.
+ * @param m Multiplier.
+ */
+static void sl_big_mul( sl_big_p b, uint32_t m )
+{
+    uint64_t carry = 0;
+
+    for ( int i = 0; i < b->n; i++ ) {
+        carry += (uint64_t)b->w[ i ] * m;
+        b->w[ i ] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if ( carry )
+        b->w[ b->n++ ] = (uint32_t)carry;
+}
+
+
+/**
+ * Multiply bignum by 10^n.
+ *
+ * @param b Bignum.
+ * @param n Exponent.
+ */
+static void sl_big_pow10( sl_big_p b, int n )
+{
+    for ( ; n >= 9; n -= 9 )
+        sl_big_mul( b, 1000000000 );
+    if ( n > 0 )
+        sl_big_mul( b, sl_pow10[ n ] );
+}
+
+
+/**
+ * Compare bignums.
+ *
+ * @param a Bignum a.
+ * @param b Bignum b.
+ *
+ * @return -1, 0, 1 (as strcmp()).
+ */
+static int sl_big_cmp( sl_big_p a, sl_big_p b )
+{
+    if ( a->n != b->n )
+        return a->n < b->n ? -1 : 1;
+
+    for ( int i = a->n - 1; i >= 0; i-- ) {
+        if ( a->w[ i ] != b->w[ i ] )
+            return a->w[ i ] < b->w[ i ] ? -1 : 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Compare sum of bignums "a" and "b" to bignum "c".
+ *
+ * @param a Bignum a.
+ * @param b Bignum b.
+ * @param c Bignum c.
+ *
+ * @return -1, 0, 1 (as strcmp()).
+ */
+static int sl_big_sum_cmp( sl_big_p a, sl_big_p b, sl_big_p c )
+{
+    sl_big_s sum;
+    uint64_t carry = 0;
+    int      n = a->n > b->n ? a->n : b->n;
+
+    for ( int i = 0; i < n; i++ ) {
+        carry += ( i < a->n ? (uint64_t)a->w[ i ] : 0 ) + ( i < b->n ? (uint64_t)b->w[ i ] : 0 );
+        sum.w[ i ] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    sum.n = n;
+    if ( carry )
+        sum.w[ sum.n++ ] = (uint32_t)carry;
+
+    return sl_big_cmp( &sum, c );
+}
+
+
+/**
+ * Divide bignum "r" by "s", when quotient is a single digit. "r" is
+ * replaced with remainder.
+ *
+ * @param r Dividend, remainder.
+ * @param s Divisor.
+ *
+ * @return Quotient.
+ */
+static int sl_big_divmod( sl_big_p r, sl_big_p s )
+{
+    int q = 0;
+
+    while ( sl_big_cmp( r, s ) >= 0 ) {
+        int64_t borrow = 0;
+        for ( int i = 0; i < r->n; i++ ) {
+            borrow += (int64_t)r->w[ i ] - ( i < s->n ? s->w[ i ] : 0 );
+            r->w[ i ] = (uint32_t)borrow;
+            borrow = borrow < 0 ? -1 : 0;
+        }
+        while ( r->n > 0 && r->w[ r->n - 1 ] == 0 )
+            r->n--;
+        q++;
+    }
+
+    return q;
+}
+
+
+/**
+ * Setup exact value of double as "r / s", with distances to
+ * neighbouring doubles as "mp / s" and "mm / s".
+ *
+ * Value "r / s" is scaled by 10^-k, where "k" is estimated, and it
+ * may be one too small.
+ *
+ * @param d  Double (positive).
+ * @param r  Value numerator.
+ * @param s  Value denominator.
+ * @param mp Distance to upper neighbour.
+ * @param mm Distance to lower neighbour.
+ * @param ok Round-trip boundaries are inclusive.
+ *
+ * @return Estimated k.
+ */
+static int sl_dtoa_setup( double d, sl_big_p r, sl_big_p s, sl_big_p mp, sl_big_p mm, int* ok )
+{
+    uint64_t bits;
+    uint64_t f;
+    int      e;
+
+    memcpy( &bits, &d, sizeof( bits ) );
+    f = bits & ( ( 1ULL << 52 ) - 1 );
+    e = ( bits >> 52 ) & 0x7ff;
+
+    if ( e == 0 ) {
+        e = -1074;
+    } else {
+        f |= 1ULL << 52;
+        e -= 1075;
+    }
+
+    *ok = ( f & 1 ) == 0;
+
+    /* Gap to lower neighbour is smaller for powers of 2. */
+    int uneven = ( f == ( 1ULL << 52 ) && e > -1074 );
+
+    sl_big_set( r, f );
+    sl_big_set( s, 1 );
+    sl_big_set( mp, 1 );
+    sl_big_set( mm, 1 );
+
+    if ( e >= 0 ) {
+        sl_big_shl( r, e + 1 + uneven );
+        sl_big_shl( s, 1 + uneven );
+        sl_big_shl( mp, e + uneven );
+        sl_big_shl( mm, e );
+    } else {
+        sl_big_shl( r, 1 + uneven );
+        sl_big_shl( s, 1 - e + uneven );
+        sl_big_shl( mp, uneven );
+    }
+
+    /* Estimate k = ceil( log10( d ) ). */
+    double est = ( 63 - __builtin_clzll( f ) + e ) * 0.30102999566398114 - 1e-10;
+    int    k = (int)est;
+    if ( est > k )
+        k++;
+
+    if ( k >= 0 ) {
+        sl_big_pow10( s, k );
+    } else {
+        sl_big_pow10( r, -k );
+        sl_big_pow10( mp, -k );
+        sl_big_pow10( mm, -k );
+    }
+
+    return k;
+}
+
+
+/**
+ * Convert positive double to shortest digit sequence, which converts
+ * back to the same double (free-format algorithm by Steele & White,
+ * and Burger & Dybvig).
+ *
+ * @param d   Double.
+ * @param dig Digits.
+ * @param kp  Decimal exponent, value is 0.DIG * 10^k.
+ *
+ * @return Digit count.
+ */
+static int sl_dtoa_shortest( double d, char* dig, int* kp )
+{
+    sl_big_s r, s, mp, mm;
+    int      ok;
+    int      n = 0;
+
+    if ( d == 0 ) {
+        dig[ 0 ] = '0';
+        *kp = 1;
+        return 1;
+    }
+
+    if ( d < 9007199254740992.0 && d == (double)(uint64_t)d ) {
+        /* Integer is its own shortest representation. */
+        uint64_t u64 = (uint64_t)d;
+        *kp = sl_u64_str_len( u64 );
+        sl_u64_to_str( u64, dig );
+        n = *kp;
+        while ( dig[ n - 1 ] == '0' )
+            n--;
+        return n;
+    }
+
+    int k = sl_dtoa_setup( d, &r, &s, &mp, &mm, &ok );
+
+    /* Estimate was too low. */
+    int c = sl_big_sum_cmp( &r, &mp, &s );
+    if ( ok ? c >= 0 : c > 0 ) {
+        k++;
+        sl_big_mul( &s, 10 );
+    }
+
+    while ( 1 ) {
+
+        sl_big_mul( &r, 10 );
+        sl_big_mul( &mp, 10 );
+        sl_big_mul( &mm, 10 );
+
+        int q = sl_big_divmod( &r, &s );
+        c = sl_big_cmp( &r, &mm );
+        int tc1 = ok ? c <= 0 : c < 0;
+        c = sl_big_sum_cmp( &r, &mp, &s );
+        int tc2 = ok ? c >= 0 : c > 0;
+
+        if ( !tc1 && !tc2 ) {
+            dig[ n++ ] = '0' + q;
+            continue;
+        }
+
+        if ( tc1 && tc2 ) {
+            /* Both neighbours possible, select closest. */
+            sl_big_s r2 = r;
+            sl_big_mul( &r2, 2 );
+            if ( sl_big_cmp( &r2, &s ) >= 0 )
+                q++;
+        } else if ( tc2 ) {
+            q++;
+        }
+
+        dig[ n++ ] = '0' + q;
+        break;
+    }
+
+    *kp = k;
+
+    return n;
+}
+
+
+/**
+ * Convert positive double to digits, with "prec" digits after the
+ * decimal point. Last digit is rounded (to even).
+ *
+ * @param d    Double.
+ * @param prec Precision.
+ * @param dig  Digits.
+ * @param kp   Decimal exponent, value is 0.DIG * 10^k.
+ *
+ * @return Digit count.
+ */
+static int sl_dtoa_fixed( double d, int prec, char* dig, int* kp )
+{
+    sl_big_s r, s, mp, mm;
+    int      ok;
+    int      n = 0;
+    int      up;
+
+    if ( d == 0 ) {
+        *kp = 0;
+        return 0;
+    }
+
+    int k = sl_dtoa_setup( d, &r, &s, &mp, &mm, &ok );
+
+    if ( sl_big_cmp( &r, &s ) >= 0 ) {
+        k++;
+        sl_big_mul( &s, 10 );
+    }
+
+    int cnt = k + prec;
+
+    if ( cnt < 0 ) {
+        *kp = k;
+        return 0;
+    }
+
+    for ( n = 0; n < cnt; n++ ) {
+        sl_big_mul( &r, 10 );
+        dig[ n ] = '0' + sl_big_divmod( &r, &s );
+    }
+
+    /* Round half to even. */
+    sl_big_mul( &r, 2 );
+    int c = sl_big_cmp( &r, &s );
+    if ( c > 0 )
+        up = 1;
+    else if ( c == 0 )
+        up = ( n > 0 ) ? ( dig[ n - 1 ] - '0' ) & 1 : 0;
+    else
+        up = 0;
+
+    if ( up ) {
+        int i = n - 1;
+        while ( i >= 0 && dig[ i ] == '9' )
+            dig[ i-- ] = '0';
+        if ( i >= 0 ) {
+            dig[ i ]++;
+        } else {
+            /* All nines, carry to new digit. */
+            memmove( dig + 1, dig, n );
+            dig[ 0 ] = '1';
+            n++;
+            k++;
+        }
+    }
+
+    *kp = k;
+
+    return n;
+}
+
+
+/**
+ * Calculate string length of u64 string conversion.
+ *
+ * @param u64 Integer to convert.
+ *
+ * @return Length.
+ */
+static sl_size_t sl_u64_str_len( uint64_t u64 )
+{
+    /* Digits from bit count (log10(2) ~ 1233/4096), and adjust. */
+    sl_size_t t = ( ( 64 - __builtin_clzll( u64 | 1 ) ) * 1233 ) >> 12;
+    return t + ( ( u64 | 1 ) >= sl_pow10_u64[ t ] );
+}
+
+
+/**
+ * Convert u64 to string.
+ *
+ * Digits are written from the end, two at a time.
+ *
+ * @param u64 Integer to convert.
+ * @param str Storage for conversion.
+ */
+static void sl_u64_to_str( uint64_t u64, char* str )
+{
+    char* c = str + sl_u64_str_len( u64 );
+
+    *c = 0;
+
+    while ( u64 >= 100 ) {
+        const char* pair = &sl_digit_pairs[ ( u64 % 100 ) * 2 ];
+        u64 /= 100;
+        *--c = pair[ 1 ];
+        *--c = pair[ 0 ];
+    }
+
+    if ( u64 >= 10 ) {
+        *--c = sl_digit_pairs[ u64 * 2 + 1 ];
+        *--c = sl_digit_pairs[ u64 * 2 ];
+    } else {
+        *--c = '0' + u64;
+    }
+}
+
+
+/**
+ * Convert u64 to hex string (not terminated).
+ *
+ * @param u64   Integer to convert.
+ * @param str   Storage for conversion.
+ * @param len   Digit count.
+ * @param upper Use upper case.
+ */
+static void sl_u64_to_hex( uint64_t u64, char* str, sl_size_t len, int upper )
+{
+    const char* hex = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+
+    while ( len > 0 ) {
+        str[ --len ] = hex[ u64 & 0xf ];
+        u64 >>= 4;
+    }
+}
+
+
+/**
+ * Calculate string length of i64 string conversion.
+ *
+ * @param i64 Integer to convert.
+ *
+ * @return Length.
+ */
+static sl_size_t sl_i64_str_len( int64_t i64 )
+{
+    if ( i64 < 0 ) {
+        return sl_u64_str_len( 0 - (uint64_t)i64 ) + 1;
+    } else {
+        return sl_u64_str_len( i64 );
+    }
+}
+
+
+/**
+ * Convert i64 to string.
+ *
+ * @param i64 Integer to convert.
+ * @param str Storage for conversion.
+ */
+static void sl_i64_to_str( int64_t i64, char* str )
 {
-    printf( "%s\n", ss );
-    printf( "  len: %d\n", sl_len( ss ) );
-    printf( "  res: %d\n", sl_res( ss ) );
+    if ( i64 < 0 ) {
+        *str++ = '-';
+        sl_u64_to_str( 0 - (uint64_t)i64, str );
+    } else {
+        sl_u64_to_str( i64, str );
+    }
 }
 
 
+/**
+ * Create rope node with chunk.
+ *
+ * @param str  Chunk content.
+ * @param len  Chunk length.
+ * @param prio Node priority.
+ *
+ * @return Node.
+ */
+static sl_rope_node_p sl_rope_leaf( const char* str, size_t len, uint32_t prio )
+{
+    sl_rope_node_p t = sl_malloc( sizeof( sl_rope_node_s ) );
+    t->left = NULL;
+    t->right = NULL;
+    t->str = sl_new( len + 1 );
+    memcpy( t->str, str, len );
+    t->str[ len ] = 0;
+    sl_len( t->str ) = len;
+    t->size = len;
+    t->prio = prio;
+    return t;
+}
 
 
-/* ------------------------------------------------------------
- * Utility functions.
- * ------------------------------------------------------------ */
+/**
+ * Update subtree size of rope node.
+ *
+ * @param t Node.
+ */
+static void sl_rope_update( sl_rope_node_p t )
+{
+    t->size = sl_len( t->str );
+    if ( t->left )
+        t->size += t->left->size;
+    if ( t->right )
+        t->size += t->right->size;
+}
 
 
 /**
- * Copy "src" to "dst" and return pointer to end of "dst".
+ * Locate rope node for position.
  *
- * @param dst Destination str.
- * @param src Source str.
+ * Without "at", position is an insertion point, and it may be at
+ * the chunk end. With "at", position is a char position and it is
+ * within the chunk. Subtree sizes along the path are adjusted by
+ * "delta".
  *
- * @return Pointer to dst end.
+ * @param t     Root node.
+ * @param pos   Position.
+ * @param at    Char position (instead of insertion point).
+ * @param off   Position within chunk.
+ * @param delta Size adjustment.
+ *
+ * @return Node.
  */
-static char* sl_copy_setup( char* dst, char* src )
+static sl_rope_node_p sl_rope_locate( sl_rope_node_p t, size_t pos, int at, size_t* off, int64_t delta )
 {
-    int i = 0;
-    while ( src[ i ] ) {
-        dst[ i ] = src[ i ];
-        i++;
+    while ( 1 ) {
+        size_t ls = t->left ? t->left->size : 0;
+        size_t c = sl_len( t->str );
+        t->size += delta;
+        if ( pos < ls ) {
+            t = t->left;
+        } else if ( pos + at <= ls + c ) {
+            *off = pos - ls;
+            return t;
+        } else {
+            pos -= ls + c;
+            t = t->right;
+        }
     }
-    return &( dst[ i ] );
 }
 
 
 /**
- * Return file size or (-1 on error).
+ * Split rope at position to nodes before (a) and after (b).
  *
- * @param filename Name of file.
+ * Chunk is split if position is within chunk.
  *
- * @return File size.
+ * @param t   Root node.
+ * @param pos Split position.
+ * @param a   Content before position.
+ * @param b   Content after position.
  */
-static off_t sl_file_size( const char* filename )
+static void sl_rope_split( sl_rope_node_p t, size_t pos, sl_rope_node_p* a, sl_rope_node_p* b )
 {
-    struct stat st;
+    if ( t == NULL ) {
+        *a = NULL;
+        *b = NULL;
+        return;
+    }
 
-    if ( stat( filename, &st ) == 0 )
-        return st.st_size;
+    size_t ls = t->left ? t->left->size : 0;
+    size_t c = sl_len( t->str );
 
-    return -1; // GCOV_EXCL_LINE
+    if ( pos <= ls ) {
+        sl_rope_split( t->left, pos, a, &t->left );
+        *b = t;
+    } else if ( pos >= ls + c ) {
+        sl_rope_split( t->right, pos - ls - c, &t->right, b );
+        *a = t;
+    } else {
+        /* Tail of chunk to new node, which inherits the right
+         * subtree. Same priority keeps heap order. */
+        size_t         off = pos - ls;
+        sl_rope_node_p n = sl_rope_leaf( t->str + off, c - off, t->prio );
+        n->right = t->right;
+        sl_rope_update( n );
+        t->right = NULL;
+        t->str[ off ] = 0;
+        sl_len( t->str ) = off;
+        *a = t;
+        *b = n;
+    }
+
+    sl_rope_update( t );
 }
 
 
 /**
- * Normalize (possibly negative) SL index. Positive index is saturated
- * to SL length, and negative index is normalized.
- *
- * -1 means last char in SL, -2 second to last, etc. Index after last
- * char can only be expressed by positive indeces. E.g. for SL with
- * length of 4 the indeces are:
+ * Merge ropes, "a" content before "b" content.
  *
- * Chars:     a  b  c  d  \0
- * Positive:  0  1  2  3  4
- * Negative: -4 -3 -2 -1
- *
- * @param ss  SL.
- * @param idx Index to SL.
+ * @param a Rope node a.
+ * @param b Rope node b.
  *
- * @return Unsigned (positive) index to SL.
+ * @return Merged root.
  */
-static sl_size_t sl_norm_idx( sl_t ss, int idx )
+static sl_rope_node_p sl_rope_merge( sl_rope_node_p a, sl_rope_node_p b )
 {
-    sl_size_t ret;
-
-    if ( idx < 0 ) {
-        ret = sl_len( ss ) + idx;
-    } else if ( (sl_size_t)idx > sl_len( ss ) ) {
-        ret = sl_len( ss );
+    if ( a == NULL )
+        return b;
+    if ( b == NULL )
+        return a;
+
+    if ( a->prio > b->prio ) {
+        a->right = sl_rope_merge( a->right, b );
+        sl_rope_update( a );
+        return a;
     } else {
-        ret = idx;
+        b->left = sl_rope_merge( a, b->left );
+        sl_rope_update( b );
+        return b;
     }
-
-    return ret;
 }
 
 
 /**
- * Copy s2 to s1.
+ * Copy rope content range to "dst".
  *
- * @param s1   SL target.
- * @param s2   Source string.
- * @param len1 s2 length + 1
+ * @param t   Root node.
+ * @param pos Range start.
+ * @param len Range length.
+ * @param dst Destination.
+ */
+static void sl_rope_copy( sl_rope_node_p t, size_t pos, size_t len, char* dst )
+{
+    while ( t && len > 0 ) {
+
+        size_t ls = t->left ? t->left->size : 0;
+        size_t c = sl_len( t->str );
+        size_t n;
+
+        if ( pos < ls ) {
+            n = ls - pos < len ? ls - pos : len;
+            sl_rope_copy( t->left, pos, n, dst );
+            dst += n;
+            len -= n;
+            pos = ls;
+        }
+
+        if ( len > 0 && pos < ls + c ) {
+            n = ls + c - pos < len ? ls + c - pos : len;
+            memcpy( dst, t->str + pos - ls, n );
+            dst += n;
+            len -= n;
+            pos += n;
+        }
+
+        pos -= ls + c;
+        t = t->right;
+    }
+}
+
+
+/**
+ * Free rope nodes.
  *
- * @return SL.
+ * @param t Root node.
  */
-static sl_t sl_copy_base( sl_p s1, char* s2, sl_size_t len1 )
+static void sl_rope_free( sl_rope_node_p t )
 {
-    sl_reserve( s1, len1 );
-    strncpy( *s1, s2, len1 );
-    sl_len( *s1 ) = len1 - 1;
-    return *s1;
+    while ( t ) {
+        sl_rope_node_p r = t->right;
+        sl_rope_free( t->left );
+        sl_del( &t->str );
+        sl_free( t );
+        t = r;
+    }
 }
 
 
 /**
- * Compare two strings.
+ * Generate rope node priority (xorshift).
  *
- * @param s1 String 1.
- * @param s2 String 2.
+ * @param r Rope.
  *
- * @return Return "strcmp" result.
+ * @return Priority.
  */
-static int sl_compare_base( const void* s1, const void* s2 )
+static uint32_t sl_rope_rand( sl_rope_t r )
 {
-    return strcmp( *(char* const*)s1, *(char* const*)s2 );
+    r->seed ^= r->seed << 13;
+    r->seed ^= r->seed >> 17;
+    r->seed ^= r->seed << 5;
+    return r->seed;
 }
 
 
 /**
- * Concatenate s2 to s1.
+ * Mix two words (128-bit product folded to 64 bits).
  *
- * @param s1   SL target.
- * @param s2   Source string.
- * @param len1 s2 length + 1.
+ * @param a Word.
+ * @param b Word.
  *
- * @return SL.
+ * @return Mixed word.
  */
-static sl_t sl_concatenate_base( sl_p s1, char* s2, sl_size_t len1 )
+static inline uint64_t sl_hash_mix( uint64_t a, uint64_t b )
 {
-    sl_reserve( s1, sl_len( *s1 ) + len1 );
-    strncpy( sl_end( *s1 ), s2, len1 );
-    sl_len( *s1 ) += len1 - 1;
-    return *s1;
+#if defined( __SIZEOF_INT128__ )
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)( r >> 64 );
+#else
+    uint64_t lo = a * b;
+    uint64_t hi = ( ( a >> 32 ) * ( b >> 32 ) ) + ( ( ( a >> 32 ) * (uint32_t)b ) >> 32 )
+                  + ( ( (uint32_t)a * ( b >> 32 ) ) >> 32 );
+    return lo ^ hi;
+#endif
 }
 
 
 /**
- * Insert s2 of with length+1 to s1 into position pos.
+ * Calculate hash for "str". Data is consumed 16 bytes at a time,
+ * and the tail is read as overlapping words.
  *
- * @param s1    String 1.
- * @param pos   Insert position.
- * @param s2    String 2.
- * @param len1  s2 length + 1.
+ * @param str String.
+ * @param len String length.
  *
- * @return SL.
+ * @return Hash (never 0).
  */
-static sl_t sl_insert_base( sl_p s1, int pos, char* s2, sl_size_t len1 )
+static uint32_t sl_hash_base( const char* str, size_t len )
 {
-    sl_size_t len = sl_len( *s1 ) + len1;
-    sl_reserve( s1, len );
+    const uint64_t k0 = 0xa0761d6478bd642full;
+    const uint64_t k1 = 0xe7037ed1a0b428dbull;
+    const uint64_t k2 = 0x8ebc6af09c88c6e3ull;
+    uint64_t       seed = k0 ^ len;
+    uint64_t       a, b;
+    uint32_t       h;
+
+    if ( len <= 16 ) {
+        if ( len >= 8 ) {
+            memcpy( &a, str, 8 );
+            memcpy( &b, str + len - 8, 8 );
+        } else if ( len >= 4 ) {
+            uint32_t x, y;
+            memcpy( &x, str, 4 );
+            memcpy( &y, str + len - 4, 4 );
+            a = x;
+            b = y;
+        } else if ( len > 0 ) {
+            a = ( (uint64_t)(uint8_t)str[ 0 ] << 16 ) | ( (uint64_t)(uint8_t)str[ len >> 1 ] << 8 )
+                | (uint8_t)str[ len - 1 ];
+            b = 0;
+        } else {
+            a = 0;
+            b = 0;
+        }
+    } else {
+        size_t i = len;
+        while ( i > 16 ) {
+            memcpy( &a, str, 8 );
+            memcpy( &b, str + 8, 8 );
+            seed = sl_hash_mix( a ^ k1, b ^ seed );
+            str += 16;
+            i -= 16;
+        }
+        memcpy( &a, str + i - 16, 8 );
+        memcpy( &b, str + i - 8, 8 );
+    }
 
-    len1--;
+    seed = sl_hash_mix( k1 ^ len, sl_hash_mix( a ^ k1, b ^ seed ) ^ k2 );
+    h = (uint32_t)( seed ^ ( seed >> 32 ) );
 
-    sl_size_t posn = sl_norm_idx( *s1, pos );
+    /* Zero is reserved for "not hashed". */
+    return h ? h : 1;
+}
 
-    /*
-     *          tail
-     *         /
-     * abcd....efghi
-     */
 
-    sl_size_t tail = posn + len1;
+/**
+ * Allocate empty map storage.
+ *
+ * @param m   Map.
+ * @param cap Slot count (power of two).
+ */
+static void sl_map_alloc( sl_map_p m, size_t cap )
+{
+    m->ctrl = sl_malloc( cap + SL_MAP_GROUP );
+    memset( m->ctrl, SL_MAP_EMPTY, cap + SL_MAP_GROUP );
+    m->slot = sl_malloc( cap * sizeof( sl_map_slot_s ) );
+    m->cap = cap;
+    m->cnt = 0;
+    m->left = cap - cap / 8;
+}
 
-    memmove( ( *s1 ) + tail, ( *s1 ) + posn, ( sl_len( *s1 ) - posn ) );
-    strncpy( ( *s1 ) + posn, s2, len1 );
-    sl_len( *s1 ) += len1;
 
-    /* Terminate change SL. */
-    sl_base_p s = sl_base( *s1 );
-    s->str[ s->len ] = 0;
+/**
+ * Move map entries to new storage. Keys carry their hashes, hence
+ * no rehashing of content is needed.
+ *
+ * @param m   Map.
+ * @param cap New slot count.
+ */
+static void sl_map_rehash( sl_map_p m, size_t cap )
+{
+    uint8_t*       ctrl = m->ctrl;
+    sl_map_slot_s* slot = m->slot;
+    size_t         old = m->cap;
+    size_t         cnt = m->cnt;
+
+    sl_map_alloc( m, cap );
+
+    for ( size_t i = 0; i < old; i++ ) {
+        if ( !( ctrl[ i ] & 0x80 ) ) {
+            uint32_t h = sl_ext( sl_base( slot[ i ].key ) )->hash;
+            size_t   j = sl_map_free_slot( m, h );
+            sl_map_set_ctrl( m, j, h & 0x7f );
+            m->slot[ j ] = slot[ i ];
+        }
+    }
 
+    m->cnt = cnt;
+    m->left -= cnt;
 
-    return *s1;
+    sl_free( ctrl );
+    sl_free( slot );
 }
 
 
 /**
- * Divide SL by replacing "c" with 0. Count the number of segments and
- * assign "div" to point to start of each segment.
- *
- * If size is less than 0, count only the number of segments.
+ * Return bitmask of control bytes in group matching "v".
  *
- * @param ss   SL.
- * @param c    Division char.
- * @param size Segment limit (size of div).
- * @param div  Storage for segments.
+ * @param ctrl Group start.
+ * @param v    Control value.
  *
- * @return Number of segments.
+ * @return Match mask.
  */
-static int sl_divide_base( sl_t ss, char c, int size, char** div )
+static uint32_t sl_map_match( const uint8_t* ctrl, uint8_t v )
 {
-    int   divcnt = 0;
-    char *a, *b;
+#if defined( __SSE2__ )
+    __m128i g = _mm_loadu_si128( (const __m128i*)ctrl );
+    return (uint32_t)_mm_movemask_epi8( _mm_cmpeq_epi8( g, _mm_set1_epi8( (char)v ) ) );
+#else
+    uint32_t mask = 0;
+    for ( int i = 0; i < SL_MAP_GROUP; i++ ) {
+        if ( ctrl[ i ] == v )
+            mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
 
-    a = ss;
-    b = ss;
 
-    while ( *b ) {
-        if ( *b == c ) {
-            if ( size >= 0 )
-                *b = 0;
-            if ( divcnt < size ) {
-                div[ divcnt ] = a;
-                b += 1;
-                a = b;
-            }
-            divcnt++;
-        }
-        b++;
+/**
+ * Return bitmask of free (empty or deleted) control bytes in group.
+ *
+ * @param ctrl Group start.
+ *
+ * @return Free mask.
+ */
+static uint32_t sl_map_match_free( const uint8_t* ctrl )
+{
+#if defined( __SSE2__ )
+    return (uint32_t)_mm_movemask_epi8( _mm_loadu_si128( (const __m128i*)ctrl ) );
+#else
+    uint32_t mask = 0;
+    for ( int i = 0; i < SL_MAP_GROUP; i++ ) {
+        if ( ctrl[ i ] & 0x80 )
+            mask |= 1u << i;
     }
+    return mask;
+#endif
+}
 
-    if ( divcnt < size && size >= 0 )
-        div[ divcnt ] = a;
 
-    return divcnt + 1;
+/**
+ * Set slot control byte, and its clone when in the first group.
+ *
+ * @param m Map.
+ * @param i Slot index.
+ * @param v Control value.
+ */
+static void sl_map_set_ctrl( sl_map_p m, size_t i, uint8_t v )
+{
+    m->ctrl[ i ] = v;
+    m->ctrl[ ( ( i - ( SL_MAP_GROUP - 1 ) ) & ( m->cap - 1 ) ) + ( SL_MAP_GROUP - 1 ) ] = v;
 }
 
 
 /**
- * Segment SL by replacing "sc" with 0. Count the number of segments
- * and assign "div" to point to start of each segment.
+ * Return probe start position for hash "h".
  *
- * If size is less than 0, count only the number of segments.
+ * Full hash is spread by multiplication, and position is taken from
+ * the top bits of the product. Hence all hash bits select position,
+ * also with tables larger than 2^25 slots. Control byte takes the low
+ * 7 bits as is.
  *
- * @param ss   SL.
- * @param c    Division char.
- * @param size Segment limit (size of div).
- * @param div  Storage for segments.
+ * @param m Map.
+ * @param h Key hash.
  *
- * @return Number of segments.
+ * @return Slot index.
  */
-static int sl_segment_base( sl_t ss, char* sc, int size, char** div )
+static inline size_t sl_map_start( sl_map_p m, uint32_t h )
 {
-    int   divcnt = 0;
-    int   idx;
-    int   len = strlen( sc );
-    char *a, *b;
-
-    a = ss;
-    b = ss;
-
-    while ( *a ) {
-        idx = sl_find_index( a, sc );
-        if ( idx >= 0 ) {
-            b = a + idx;
-            if ( size >= 0 )
-                *b = 0;
-            if ( divcnt < size ) {
-                div[ divcnt ] = a;
-            }
-            b += len;
-            a = b;
-            divcnt++;
-        } else {
-            break;
-        }
-    }
-
-    if ( divcnt < size && size >= 0 )
-        div[ divcnt ] = a;
-
-    return divcnt + 1;
+    return ( (uint64_t)h * 0x9e3779b97f4a7c15ULL ) >> ( 64 - __builtin_ctzll( m->cap ) );
 }
 
 
 /**
- * Calculate string length of u64 string conversion.
+ * Find slot of "key".
  *
- * @param u64 Integer to convert.
+ * @param m   Map.
+ * @param key Key content.
+ * @param len Key length.
+ * @param h   Key hash.
  *
- * @return Length.
+ * @return Slot index or SIZE_MAX if not found.
  */
-static sl_size_t sl_u64_str_len( uint64_t u64 )
+static size_t sl_map_find( sl_map_p m, const char* key, sl_size_t len, uint32_t h )
 {
-    sl_size_t len = 0;
+    size_t mask = m->cap - 1;
+    size_t pos = sl_map_start( m, h );
+    size_t step = 0;
+
+    for ( ;; ) {
+        const uint8_t* g = &m->ctrl[ pos ];
+        uint32_t       hit = sl_map_match( g, h & 0x7f );
+
+        while ( hit ) {
+            size_t i = ( pos + __builtin_ctz( hit ) ) & mask;
+            sl_t   k = m->slot[ i ].key;
+            if ( sl_ext( sl_base( k ) )->hash == h && sl_len( k ) == len && memcmp( k, key, len ) == 0 )
+                return i;
+            hit &= hit - 1;
+        }
 
-    do {
-        u64 /= 10;
-        len++;
-    } while ( u64 != 0 );
+        if ( sl_map_match( g, SL_MAP_EMPTY ) )
+            return SIZE_MAX;
 
-    return len;
+        /* Triangular probing visits every group. */
+        step += SL_MAP_GROUP;
+        pos = ( pos + step ) & mask;
+    }
 }
 
 
-
 /**
- * Convert u64 to string.
+ * Find first free slot for hash "h".
  *
- * @param u64 Integer to convert.
- * @param str Storage for conversion.
+ * @param m Map.
+ * @param h Key hash.
+ *
+ * @return Slot index.
  */
-static void sl_u64_to_str( uint64_t u64, char* str )
+static size_t sl_map_free_slot( sl_map_p m, uint32_t h )
 {
-    char* c;
-
-    c = str;
-    do {
-        *c++ = ( u64 % 10 ) + '0';
-        u64 /= 10;
-    } while ( u64 != 0 );
-
-    *c = 0;
-    c--;
-
-    /* Reverse the string. */
-    char ch;
-    while ( str < c ) {
-        ch = *str;
-        *str = *c;
-        *c = ch;
-        str++;
-        c--;
+    size_t mask = m->cap - 1;
+    size_t pos = sl_map_start( m, h );
+    size_t step = 0;
+
+    for ( ;; ) {
+        uint32_t hit = sl_map_match_free( &m->ctrl[ pos ] );
+        if ( hit )
+            return ( pos + __builtin_ctz( hit ) ) & mask;
+        step += SL_MAP_GROUP;
+        pos = ( pos + step ) & mask;
     }
 }
 
 
 /**
- * Calculate string length of i64 string conversion.
- *
- * @param i64 Integer to convert.
+ * Add new entry to map. Map takes ownership of "key", which must have
+ * its hash cached.
  *
- * @return Length.
+ * @param m   Map.
+ * @param key Key (not in map).
+ * @param val Value.
  */
-static sl_size_t sl_i64_str_len( int64_t i64 )
+static void sl_map_add( sl_map_p m, sl_t key, void* val )
 {
-    if ( i64 < 0 ) {
-        return sl_u64_str_len( -i64 ) + 1;
-    } else {
-        return sl_u64_str_len( i64 );
+    uint32_t h = sl_ext( sl_base( key ) )->hash;
+    size_t   i;
+
+    if ( m->left == 0 ) {
+        /* Grow, or just clean up removed entries. */
+        if ( m->cnt >= m->cap * 7 / 16 )
+            sl_map_rehash( m, m->cap * 2 );
+        else
+            sl_map_rehash( m, m->cap );
     }
+
+    i = sl_map_free_slot( m, h );
+    if ( m->ctrl[ i ] == SL_MAP_EMPTY )
+        m->left--;
+    sl_map_set_ctrl( m, i, h & 0x7f );
+
+    m->slot[ i ].key = key;
+    m->slot[ i ].val = val;
+    m->cnt++;
 }
 
 
 /**
- * Convert i64 to string.
+ * Return canonical SL for "str".
  *
- * @param i64 Integer to convert.
- * @param str Storage for conversion.
+ * Hash selects the shard, and only the shard is locked. Canonical SLs
+ * are allocated from shard arena with hash cached.
+ *
+ * @param t   Intern table.
+ * @param str String.
+ * @param len String length.
+ *
+ * @return Canonical SL.
  */
-static void sl_i64_to_str( int64_t i64, char* str )
+static sl_t sl_intern_base( sl_intern_t t, const char* str, sl_size_t len )
 {
-    if ( i64 < 0 ) {
-        *str++ = '-';
-        sl_u64_to_str( -i64, str );
+    uint32_t           h = sl_hash_base( str, len );
+    sl_intern_shard_s* sh = &t->shard[ ( h * 0x9e3779b1u ) >> ( 32 - SL_INTERN_BITS ) ];
+    size_t             i;
+    sl_t               ss;
+
+    pthread_mutex_lock( &sh->lock );
+
+    i = sl_map_find( sh->map, str, len, h );
+    if ( i != SIZE_MAX ) {
+        ss = sh->map->slot[ i ].key;
     } else {
-        sl_u64_to_str( i64, str );
+        ss = sl_new_in( sh->arena, len + 1 );
+        memcpy( ss, str, len );
+        ss[ len ] = 0;
+        sl_len( ss ) = len;
+        sl_ext( sl_base( ss ) )->hash = h;
+        sl_map_add( sh->map, ss, NULL );
     }
+
+    pthread_mutex_unlock( &sh->lock );
+
+    return ss;
 }
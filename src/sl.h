@@ -27,6 +27,16 @@
  *                    `- length    (uint32_t)  | N + 4
  *         Content ----- string    (char*)     | N + 8
  *
+ * If SL_WIDE is defined, storage and length are 64-bit (uint64_t),
+ * and Content starts at N + 16. SL_WIDE allows SL sizes beyond 2 GiB,
+ * and positions are then 64-bit (sl_pos_t). Library and its users
+ * must be compiled with the same SL_WIDE setting.
+ *
+ * Top bit of storage is reserved for SL_EXT_FLAG, hence SL storage
+ * is limited to 2 GiB, unless SL_WIDE is used. Functions that would
+ * create or grow SL beyond the limit return NULL, and the SL is not
+ * changed.
+ *
  * Basic SL datatype is "sl_t". Most SL library functions take it as
  * argument and they also return values in that type. "sl_t" is a
  * typedef of "char*", hence it is usable by standard C library
@@ -73,6 +83,17 @@
  * concatenate the rest to SL, there will be a re-allocation. After
  * re-allocation, the storage is still the minimum, i.e 5+7+1 = 13.
  *
+ * Minimum storage is not always desirable. If SL is built up with
+ * many appends, each append might re-allocate. Growth policy can be
+ * changed globally, so that all appending functions reserve more than
+ * the minimum:
+ *
+ *     sl_cfg_growth( SL_GROW_GEOMETRIC, 50 );
+ *
+ * With geometric growth, storage grows at least by 50% at each
+ * re-allocation. Explicit reservations, sl_reserve(), are always
+ * exact.
+ *
  * Any heap allocated SL should be de-allocated after use.
  *
  *     sldel( &ss );
@@ -90,10 +111,98 @@
  *
  *     ss = sluse( buf, 128 );
  *
- * Note that stack allocated SL can't be enlarged, hence user must take
- * care that this does not happen. Also note that SL does not (in this
+ * Stack allocated SL is enlarged by moving it to heap. "sldel" frees
+ * only heap storage, hence SL should always be deleted after use,
+ * regardless of where its storage is. Note that SL does not (in this
  * case) fit a string that has 127 characters (plus null). It will only
- * fit 119 plus null, since the descriptor takes 8 bytes of space.
+ * fit 103 plus null, since the descriptor and the extension header
+ * take 24 bytes of space (32 bytes with SL_WIDE).
+ *
+ * Short lived SLs can be allocated from an arena. Arena allocation is
+ * a pointer bump, and all SLs in the arena are released at once:
+ *
+ *     sl_arena_t arena = sl_arena_new( 0 );
+ *     ss = sl_from_str_in( arena, "hello" );
+ *     ...
+ *     sl_arena_reset( arena );
+ *
+ * Arena SLs are enlarged within the arena, and they are freed only by
+ * sl_arena_reset() and sl_arena_del(). The arena must outlive its
+ * SLs.
+ *
+ * Small SLs can be allocated from a pool. Pool keeps per-thread free
+ * lists for power-of-two allocation classes, and re-uses freed SL
+ * allocations. Pool is enabled at runtime:
+ *
+ *     sl_cfg_pool( 1 );
+ *
+ * Small SLs are always allocated at class sizes, hence pool can be
+ * enabled and disabled at any time. SLs can be freed by any thread,
+ * and free lists are released at thread exit.
+ *
+ * Large strings with frequent edits in the middle can be stored to a
+ * rope. Rope is a balanced tree of SL chunks, and insert and delete
+ * only touch one chunk and the tree path to it:
+ *
+ *     sl_rope_t rope = sl_rope_new( sl_view( doc ) );
+ *     sl_rope_insert( rope, 1000, sl_view_c( "patch" ) );
+ *     ...
+ *     doc2 = sl_rope_flatten( rope );
+ *
+ * SL hash is cached to SLs with extension header, i.e. SLs created
+ * with sl_new_hashable(), arena SLs and sl_use() SLs. Cached hash is
+ * invalidated by all SL library functions that modify the
+ * content. Direct writes to SL content must be followed by
+ * sl_hash_reset(). SL keyed hash map uses the cached hashes:
+ *
+ *     sl_map_t map = sl_map_new( 0 );
+ *     sl_map_put( map, key, value );
+ *     ...
+ *     value = sl_map_get( map, key );
+ *
+ * Read-only SLs can be shared without copying. sl_share() returns a
+ * reference counted SL, and sharing it again only increments the
+ * count. First sl_share() copies the SL, unless it was created with
+ * sl_new_shareable(). Each reference is deleted with sl_del().
+ * Functions that take SLP (e.g. sl_concatenate()) detach the
+ * reference to private storage before modifying it, whereas
+ * functions that take SL (e.g. sl_toupper()) must not be used for
+ * shared SLs:
+ *
+ *     shared = sl_share( payload );
+ *     for ( i = 0; i < nthreads; i++ )
+ *         arg[ i ] = sl_share( shared );
+ *
+ * Large sets of short strings can be packed to a string table. Table
+ * stores all strings in one buffer, and strings are accessed as views
+ * by index:
+ *
+ *     sl_table_t tab = sl_table_new( 0 );
+ *     sl_table_add_c( tab, "hello" );
+ *     ...
+ *     sl_table_sort( tab, 0 );
+ *     v = sl_table_get( tab, 0 );
+ *
+ * Repeated strings can be interned. Intern table returns the same
+ * canonical SL for equal content, hence equality is a pointer
+ * compare. Canonical SLs are owned by the table and must not be
+ * modified or deleted:
+ *
+ *     sl_intern_t tab = sl_intern_new();
+ *     host = sl_intern( tab, "localhost" );
+ *     ...
+ *     sl_intern_del( &tab );
+ *
+ * Bursts of edits around a cursor are done with gap buffer
+ * editing. SL spare storage becomes a gap at the cursor, and edits at
+ * the cursor don't move the tail:
+ *
+ *     sl_gap_t gap;
+ *     sl_gap_begin( &gap, &ss, 10 );
+ *     sl_gap_push_char( &gap, 'x' );
+ *     sl_gap_backspace( &gap, 3 );
+ *     ...
+ *     sl_gap_end( &gap );
  *
  * By default SL library uses malloc and friends to do heap
  * allocations. If you define SL_MEM_API, you can use your own memory
@@ -112,18 +221,57 @@
 #include <stdarg.h>
 
 
+#ifdef SL_WIDE
+
+/** Size type. */
+typedef uint64_t sl_size_t;
+
+/** Position type. */
+typedef int64_t sl_pos_t;
+
+#else
+
 /** Size type. */
 typedef uint32_t sl_size_t;
 
+/** Position type. */
+typedef int sl_pos_t;
+
+#endif
+
+/** Sort flags. */
+#define SL_SORT_STABLE 1 /**< Keep order of equal strings. */
+#define SL_SORT_BINARY 2 /**< Binary order, see sl_compare_bin(). */
+
+/** File mapping flags, see sl_map_file(). */
+#define SL_MMAP_SEQUENTIAL 1 /**< Content is read sequentially. */
+#define SL_MMAP_WILLNEED 2   /**< Content is read soon. */
+
+/** Storage growth policy. */
+typedef enum
+{
+    SL_GROW_EXACT = 0, /**< Grow to requested size (default). */
+    SL_GROW_GEOMETRIC, /**< Grow by factor of current storage. */
+    SL_GROW_CLASS,     /**< Grow to power-of-two allocation class. */
+} sl_grow_t;
+
 /** SL structure. */
 typedef struct
 {
-    sl_size_t res;      /**< String storage size. */
+    sl_size_t res;      /**< String storage size (and SL_EXT_FLAG). */
     sl_size_t len;      /**< Length (used). */
     char      str[ 0 ]; /**< String content. */
 } sl_s;
 
 
+/**
+ * Storage flag in "res". SL storage is not a plain heap allocation,
+ * and SL has an extension header in front of the descriptor. Use
+ * sl_reservation_size() to get storage size without the flag.
+ */
+#define SL_EXT_FLAG ( (sl_size_t)1 << ( sizeof( sl_size_t ) * 8 - 1 ) )
+
+
 /** Pointer to SL. */
 typedef sl_s* sl_base_p;
 
@@ -136,6 +284,93 @@ typedef sl_t* sl_p;
 /** SL array type. */
 typedef sl_t* sl_v;
 
+/** Number of pool size classes (16 to 512 bytes). */
+#define SL_POOL_CLASSES 6
+
+/** Pool statistics for calling thread (block use is process wide). */
+typedef struct
+{
+    uint64_t hits;                       /**< Allocations from free list. */
+    uint64_t misses;                     /**< Allocations from heap. */
+    int64_t  used[ SL_POOL_CLASSES ];    /**< Blocks in use per class. */
+    uint32_t free[ SL_POOL_CLASSES ];    /**< Free list blocks per class. */
+} sl_pool_stat_s;
+
+/** Handle for compiled search pattern. */
+typedef struct sl_pattern_s* sl_pattern_t;
+
+/** Handle for compiled Quick Format. */
+typedef struct sl_fmt_s* sl_fmt_t;
+
+/** Handle for SL arena. */
+typedef struct sl_arena_s* sl_arena_t;
+
+/** Handle for rope. */
+typedef struct sl_rope_s* sl_rope_t;
+
+/** Handle for SL keyed hash map. */
+typedef struct sl_map_s* sl_map_t;
+
+/** Handle for string table. */
+typedef struct sl_table_s* sl_table_t;
+
+/** Handle for SL intern table. */
+typedef struct sl_intern_s* sl_intern_t;
+
+/** Non-owning view to SL (or any string), see sl_view(). */
+typedef struct
+{
+    const char* ptr; /**< Start of view. */
+    sl_size_t   len; /**< View length. */
+} sl_view_t;
+
+/** Split iterator, see sl_split_begin(). */
+typedef struct
+{
+    const char* cur;   /**< Start of next token. */
+    const char* end;   /**< End of SL. */
+    const char* delim; /**< Delimiter. */
+    size_t      dlen;  /**< Delimiter length. */
+    int         done;  /**< Last token returned. */
+} sl_split_iter_t;
+
+/** Builder fragments without heap allocation. */
+#define SL_BUILDER_FRAGS 16
+
+/** Builder local data without heap allocation. */
+#define SL_BUILDER_DATA 128
+
+/** Builder fragment. */
+typedef struct
+{
+    const char* ptr; /**< Fragment (or NULL for builder local data). */
+    sl_size_t   off; /**< Local data offset. */
+    sl_size_t   len; /**< Fragment length. */
+} sl_frag_s;
+
+/** String builder, see sl_builder_begin(). */
+typedef struct
+{
+    sl_frag_s* frag;                         /**< Fragments. */
+    sl_size_t  cnt;                          /**< Fragment count. */
+    sl_size_t  size;                         /**< Fragment storage size. */
+    char*      data;                         /**< Local data (numbers, chars). */
+    sl_size_t  dlen;                         /**< Local data length. */
+    sl_size_t  dsize;                        /**< Local data storage size. */
+    sl_size_t  len;                          /**< Content length. */
+    sl_frag_s  frag_buf[ SL_BUILDER_FRAGS ]; /**< Initial fragments. */
+    char       data_buf[ SL_BUILDER_DATA ];  /**< Initial local data. */
+} sl_builder_t;
+
+/** Gap buffer editing state, see sl_gap_begin(). */
+typedef struct
+{
+    sl_p      sp;  /**< Edited SL. */
+    sl_size_t len; /**< Content length. */
+    sl_size_t pos; /**< Gap start (cursor). */
+    sl_size_t end; /**< Gap end. */
+} sl_gap_t;
+
 /** Extra SL type alises. */
 typedef sl_base_p slb;
 typedef sl_t sls;
@@ -174,6 +409,7 @@ extern void* sl_realloc( void* ptr, size_t size );
 #define sluse     sl_use
 #define sldel     sl_del
 #define slres     sl_reserve
+#define slrsw     sl_reserve_with
 #define slcom     sl_compact
 #define slcpy     sl_copy
 #define slcpy_c   sl_copy_c
@@ -208,6 +444,7 @@ extern void* sl_realloc( void* ptr, size_t size );
 #define slinv     sl_invert_pos
 #define slfcr     sl_find_char_right
 #define slfcl     sl_find_char_left
+#define slfca     sl_find_char_all
 #define slidx     sl_find_index
 #define sldiv     sl_divide_with_char
 #define slseg     sl_segment_with_str
@@ -242,7 +479,7 @@ extern void* sl_realloc( void* ptr, size_t size );
  *
  * @param size String storage size.
  *
- * @return SL.
+ * @return SL (or NULL if size exceeds storage limit).
  */
 sl_t sl_new( sl_size_t size );
 
@@ -250,13 +487,22 @@ sl_t sl_new( sl_size_t size );
 /**
  * Use existing memory allocation for SL.
  *
- * "size" is for the whole SL, including descriptor and string
- * storage. Hence string storage is 8 bytes smaller that "size".
+ * "size" is for the whole SL, including extension header,
+ * descriptor and string storage. Hence string storage is 24 bytes
+ * (32 with SL_WIDE) smaller that "size".
+ *
+ * SL storage is marked as external. If SL is enlarged, it is moved to
+ * heap, and "mem" is not used anymore. "mem" is never freed by SL
+ * library. Compaction has no effect while SL is in "mem".
+ *
+ * "mem" must be aligned for pointers, and "size" must have room for
+ * at least the terminating null. Storage beyond the SL size limit is
+ * not used.
  *
  * @param mem   Allocation for SL.
  * @param size  Allocation size.
  *
- * @return SL.
+ * @return SL (or NULL if "mem" is too small or misaligned).
  */
 sl_t sl_use( void* mem, sl_size_t size );
 
@@ -264,6 +510,9 @@ sl_t sl_use( void* mem, sl_size_t size );
 /**
  * Delete SL.
  *
+ * Arena SL storage is released only with the arena, and external
+ * storage (see sl_use()) is not released.
+ *
  * @param ss SLP.
  *
  * @return NULL
@@ -271,6 +520,105 @@ sl_t sl_use( void* mem, sl_size_t size );
 sl_t sl_del( sl_p sp );
 
 
+/**
+ * Create new SL with hash caching.
+ *
+ * SL is heap allocated with an extension header, which holds the
+ * cached hash (see sl_hash()).
+ *
+ * @param size String storage size.
+ *
+ * @return SL (or NULL if size exceeds storage limit).
+ */
+sl_t sl_new_hashable( sl_size_t size );
+
+
+/**
+ * Create new SL with shareable storage.
+ *
+ * SL is a sole reference to shared storage. It is modified in place
+ * like a heap SL, and sl_share() of it only increments the reference
+ * count.
+ *
+ * @param size String storage size.
+ *
+ * @return SL (or NULL if size exceeds storage limit).
+ */
+sl_t sl_new_shareable( sl_size_t size );
+
+
+/**
+ * Share SL.
+ *
+ * If "ss" is shared already (see sl_new_shareable()), reference count
+ * is incremented and "ss" is returned, which is O(1). Otherwise a
+ * shared copy of "ss" is returned, which is O(n), and "ss" is not
+ * changed. Shared SL is immutable, but it can be passed to
+ * functions that take SLP, since they detach it first. Reference
+ * counting is thread safe.
+ *
+ * @param ss SL.
+ *
+ * @return Shared SL.
+ */
+sl_t sl_share( sl_t ss );
+
+
+/**
+ * Create new SL in arena.
+ *
+ * @param arena Arena.
+ * @param size  String storage size.
+ *
+ * @return SL (or NULL if size exceeds storage limit).
+ */
+sl_t sl_new_in( sl_arena_t arena, sl_size_t size );
+
+
+/**
+ * Create SL in arena based on CSTR with size from CSTR.
+ *
+ * @param arena Arena.
+ * @param cs    CSTR.
+ *
+ * @return SL.
+ */
+sl_t sl_from_str_in( sl_arena_t arena, char* cs );
+
+
+/**
+ * Create arena for SL allocations.
+ *
+ * Arena storage is allocated in chunks of "size" bytes. Larger chunks
+ * are allocated for SLs that do not fit to "size".
+ *
+ * @param size Chunk size (0 for default).
+ *
+ * @return Arena.
+ */
+sl_arena_t sl_arena_new( size_t size );
+
+
+/**
+ * Release all SLs in arena.
+ *
+ * Arena storage is kept for re-use.
+ *
+ * @param arena Arena.
+ */
+void sl_arena_reset( sl_arena_t arena );
+
+
+/**
+ * Delete arena and all SLs in it.
+ *
+ * @param ap Arena handle.
+ *
+ * @return NULL
+ */
+sl_arena_t sl_arena_del( sl_arena_t* ap );
+
+
 /**
  * Update SL storage to size.
  *
@@ -279,11 +627,71 @@ sl_t sl_del( sl_p sp );
  * @param sp   SLP.
  * @param size Storage size.
  *
- * @return SL.
+ * @return SL (or NULL if size exceeds storage limit).
  */
 sl_t sl_reserve( sl_p sp, sl_size_t size );
 
 
+/**
+ * Update SL storage to size using growth policy.
+ *
+ * If current storage is bigger, do nothing. Otherwise storage is
+ * enlarged according to "grow", but at least to "size".
+ *
+ * @param sp   SLP.
+ * @param size Storage size.
+ * @param grow Growth policy.
+ *
+ * @return SL (or NULL if size exceeds storage limit).
+ */
+sl_t sl_reserve_with( sl_p sp, sl_size_t size, sl_grow_t grow );
+
+
+/**
+ * Set growth policy for appending functions.
+ *
+ * Appending functions, e.g. slcat() and slfmt(), use this policy
+ * when storage needs to be enlarged. Default is SL_GROW_EXACT.
+ *
+ * "factor" is storage growth percentage for SL_GROW_GEOMETRIC, and
+ * ignored by other policies. Default is 50 (i.e. 1.5x).
+ *
+ * @param grow   Growth policy.
+ * @param factor Growth percentage.
+ */
+void sl_cfg_growth( sl_grow_t grow, sl_size_t factor );
+
+
+/**
+ * Enable or disable pool allocation for small SLs.
+ *
+ * Pool is used for SLs which have total allocation (descriptor and
+ * storage) of 512 bytes or less. Such SLs are always allocated at
+ * power-of-two class sizes, hence pool can be toggled while heap SLs
+ * exist. With pool, freed blocks are kept in per-thread free lists,
+ * which are released at thread exit. SL may be freed by any thread.
+ *
+ * @param enable Pool enable (1) or disable (0).
+ */
+void sl_cfg_pool( int enable );
+
+
+/**
+ * Get pool statistics for calling thread.
+ *
+ * @param stat Storage for statistics.
+ */
+void sl_pool_stat( sl_pool_stat_s* stat );
+
+
+/**
+ * Release free list blocks of calling thread to heap.
+ *
+ * Free lists are released automatically at thread exit.
+ */
+void sl_pool_trim( void );
+
+
 /**
  * Compact storage to minimum size.
  *
@@ -463,6 +871,8 @@ int sl_compare( sl_t s1, sl_t s2 );
 /**
  * Are two SL strings different?
  *
+ * Comparison covers SL lengths, i.e. also embedded nulls.
+ *
  * @param s1 Reference SL.
  * @param s2 Compared SL.
  *
@@ -471,15 +881,111 @@ int sl_compare( sl_t s1, sl_t s2 );
 int sl_is_different( sl_t s1, sl_t s2 );
 
 
+/**
+ * Compare two SL as binary data.
+ *
+ * Bytes are compared as unsigned up to the shorter length, and
+ * shorter SL is first if they are equal. Embedded nulls are
+ * compared as any other byte.
+ *
+ * @param s1 Reference SL.
+ * @param s2 Compared SL.
+ *
+ * @return -1,0,1.
+ */
+int sl_compare_bin( sl_t s1, sl_t s2 );
+
+
+/**
+ * Are two SL strings equal (binary)?
+ *
+ * @param s1 Reference SL.
+ * @param s2 Compared SL.
+ *
+ * @return 1 if equal.
+ */
+int sl_equal( sl_t s1, sl_t s2 );
+
+
+/**
+ * Return SL hash (non-cryptographic, never 0).
+ *
+ * Hash is cached if SL has an extension header. Repeated calls for
+ * unmodified SL are then O(1). If both SLs have cached hashes,
+ * sl_equal() rejects mismatches without comparing content.
+ *
+ * @param ss SL.
+ *
+ * @return Hash.
+ */
+uint32_t sl_hash( sl_t ss );
+
+
+/**
+ * Invalidate cached hash.
+ *
+ * Required only after modifying SL content directly, i.e. without
+ * SL library functions.
+ *
+ * @param ss SL.
+ */
+void sl_hash_reset( sl_t ss );
+
+
 /**
  * Sort SL array to alphabetical order.
  *
+ * Order is the same as with "strcmp". Sort is MSD radix sort, which
+ * compares only the bytes beyond common prefixes.
+ *
  * @param sa   SL array.
  * @param len  SL array length.
  */
 void sl_sort( sl_v sa, sl_size_t len );
 
 
+/**
+ * Sort SL array with flags.
+ *
+ * SL_SORT_STABLE keeps equal SLs in original order, and uses
+ * additional memory. SL_SORT_BINARY sorts to sl_compare_bin() order,
+ * including embedded nulls.
+ *
+ * @param sa    SL array.
+ * @param len   SL array length.
+ * @param flags Sort flags.
+ */
+void sl_sort_with( sl_v sa, sl_size_t len, int flags );
+
+
+/**
+ * Sort CSTR array to alphabetical order.
+ *
+ * SL_SORT_BINARY is ignored, since CSTRs have no length.
+ *
+ * @param sa    CSTR array.
+ * @param len   CSTR array length.
+ * @param flags Sort flags.
+ */
+void sl_sort_cstr( char** sa, sl_size_t len, int flags );
+
+
+/**
+ * Sort SL array to alphabetical order with multiple threads.
+ *
+ * Order is the same as with slsrt(). nthreads-1 splitters are
+ * sampled from the array, and strings are distributed to 2*nthreads-1
+ * buckets: ranges between splitters, and one bucket for strings equal
+ * to each splitter. Range buckets are sorted in parallel, and equal
+ * buckets need no sorting. Small arrays are sorted with slsrt().
+ *
+ * @param sa       SL array.
+ * @param len      SL array length.
+ * @param nthreads Thread count (max 256).
+ */
+void sl_sort_parallel( sl_v sa, sl_size_t len, int nthreads );
+
+
 /**
  * Concatenate SL to SL.
  *
@@ -512,7 +1018,7 @@ sl_t sl_concatenate_c( sl_p s1, char* s2 );
  *
  * @return SL.
  */
-sl_t sl_push_char_to( sl_p sp, int pos, char c );
+sl_t sl_push_char_to( sl_p sp, sl_pos_t pos, char c );
 
 
 /**
@@ -525,7 +1031,7 @@ sl_t sl_push_char_to( sl_p sp, int pos, char c );
  *
  * @return SL.
  */
-sl_t sl_pop_char_from( sl_t ss, int pos );
+sl_t sl_pop_char_from( sl_t ss, sl_pos_t pos );
 
 
 /**
@@ -538,7 +1044,7 @@ sl_t sl_pop_char_from( sl_t ss, int pos );
  *
  * @return SL.
  */
-sl_t sl_limit_to_pos( sl_t ss, int pos );
+sl_t sl_limit_to_pos( sl_t ss, sl_pos_t pos );
 
 
 /**
@@ -552,7 +1058,7 @@ sl_t sl_limit_to_pos( sl_t ss, int pos );
  *
  * @return SL.
  */
-sl_t sl_cut( sl_t ss, int cnt );
+sl_t sl_cut( sl_t ss, sl_pos_t cnt );
 
 
 /**
@@ -568,7 +1074,7 @@ sl_t sl_cut( sl_t ss, int cnt );
  *
  * @return SL.
  */
-sl_t sl_select_slice( sl_t ss, int a, int b );
+sl_t sl_select_slice( sl_t ss, sl_pos_t a, sl_pos_t b );
 
 
 /**
@@ -580,7 +1086,7 @@ sl_t sl_select_slice( sl_t ss, int a, int b );
  *
  * @return Target.
  */
-sl_t sl_insert_to( sl_p s1, int pos, sl_t s2 );
+sl_t sl_insert_to( sl_p s1, sl_pos_t pos, sl_t s2 );
 
 
 /**
@@ -592,7 +1098,7 @@ sl_t sl_insert_to( sl_p s1, int pos, sl_t s2 );
  *
  * @return Target.
  */
-sl_t sl_insert_to_c( sl_p s1, int pos, char* s2 );
+sl_t sl_insert_to_c( sl_p s1, sl_pos_t pos, char* s2 );
 
 
 /**
@@ -618,6 +1124,36 @@ sl_t sl_format( sl_p sp, char* fmt, ... );
 sl_t sl_va_format( sl_p sp, char* fmt, va_list ap );
 
 
+/**
+ * Formatted (printf style) print to SL with size hint.
+ *
+ * Output is formatted directly to SL spare storage, and storage is
+ * reserved for at least "hint" more chars before that. If output
+ * doesn't fit, SL is enlarged and output is formatted again. Good
+ * hint avoids the second formatting.
+ *
+ * @param sp   SLP.
+ * @param hint Expected output length.
+ * @param fmt  Format.
+ *
+ * @return SL.
+ */
+sl_t sl_format_hint( sl_p sp, sl_size_t hint, char* fmt, ... );
+
+
+/**
+ * Variable Arguments (VA) version of sl_format_hint().
+ *
+ * @param sp   SLP.
+ * @param hint Expected output length.
+ * @param fmt  Format.
+ * @param ap   VA list.
+ *
+ * @return SL.
+ */
+sl_t sl_va_format_hint( sl_p sp, sl_size_t hint, char* fmt, va_list ap );
+
+
 /**
  * Quick Formatted print to SL.
  *
@@ -630,9 +1166,19 @@ sl_t sl_va_format( sl_p sp, char* fmt, va_list ap );
  *     %I = 64-bit integer.
  *     %u = Unsigned integer.
  *     %U = Unsigned 64-bit integer.
+ *     %d = Integer (same as %i).
+ *     %x = Hex (lowercase), %lx for 64-bit.
+ *     %X = Hex (uppercase), %lX for 64-bit.
+ *     %f = Double, shortest round-trip, or fixed with "%.Nf".
+ *     %g = Double, shortest round-trip, exponent form for large
+ *          and small values.
  *     %c = Character.
  *     %% = Literal '%'.
  *
+ * Width and flags '-' (left align) and '0' (zero pad) are
+ * supported, e.g. "%-8s" and "%08x". Unknown conversions are
+ * output as is.
+ *
  * @param sp   SLP.
  * @param fmt  Quick Format.
  *
@@ -653,6 +1199,59 @@ sl_t sl_format_quick( sl_p sp, char* fmt, ... );
 sl_t sl_va_format_quick( sl_p sp, char* fmt, va_list ap );
 
 
+/**
+ * Compile Quick Format.
+ *
+ * Format is split to literals and conversions once, and compiled
+ * format can be applied any number of times. Compiled format is
+ * independent of "fmt".
+ *
+ *     sl_fmt_t f = sl_fmt_compile( "%s: %i ms\n" );
+ *     sl_fmt_apply( &log, f, name, ms );
+ *
+ * @param fmt Quick Format.
+ *
+ * @return Compiled format.
+ */
+sl_fmt_t sl_fmt_compile( char* fmt );
+
+
+/**
+ * Delete compiled format.
+ *
+ * @param fp Compiled format handle.
+ *
+ * @return NULL
+ */
+sl_fmt_t sl_fmt_del( sl_fmt_t* fp );
+
+
+/**
+ * Formatted print to SL with compiled format.
+ *
+ * Same as slfmq(), but format is not parsed and arguments are
+ * walked once.
+ *
+ * @param sp  SLP.
+ * @param fmt Compiled format.
+ *
+ * @return SL.
+ */
+sl_t sl_fmt_apply( sl_p sp, sl_fmt_t fmt, ... );
+
+
+/**
+ * Variable Arguments (VA) version of sl_fmt_apply().
+ *
+ * @param sp  SLP.
+ * @param fmt Compiled format.
+ * @param ap  VA list.
+ *
+ * @return SL.
+ */
+sl_t sl_va_fmt_apply( sl_p sp, sl_fmt_t fmt, va_list ap );
+
+
 /**
  * Invert position index.
  *
@@ -664,7 +1263,7 @@ sl_t sl_va_format_quick( sl_p sp, char* fmt, va_list ap );
  *
  * @return Inverted pos.
  */
-int sl_invert_pos( sl_t ss, int pos );
+sl_pos_t sl_invert_pos( sl_t ss, sl_pos_t pos );
 
 
 /**
@@ -676,7 +1275,7 @@ int sl_invert_pos( sl_t ss, int pos );
  *
  * @return Pos (or -1 if not found).
  */
-int sl_find_char_right( sl_t ss, char c, sl_size_t pos );
+sl_pos_t sl_find_char_right( sl_t ss, char c, sl_size_t pos );
 
 
 /**
@@ -688,20 +1287,246 @@ int sl_find_char_right( sl_t ss, char c, sl_size_t pos );
  *
  * @return Pos (or -1 if not found).
  */
-int sl_find_char_left( sl_t ss, char c, sl_size_t pos );
+sl_pos_t sl_find_char_left( sl_t ss, char c, sl_size_t pos );
 
 
 /**
- * Find "s2" from "s1". Return position or -1 if not found.
+ * Find all positions of char.
  *
- * "s2" can be SL or CSTR.
+ * If "*idx" is NULL, storage is allocated and grown to hold all
+ * positions, and user must free it with sl_free(). Otherwise "*idx"
+ * is pre-allocated storage and up to "size" positions are stored.
  *
- * @param s1  Base.
- * @param s2  Find.
+ * Return value is the total count of chars, which might be more than
+ * "size" for pre-allocated storage.
  *
- * @return Pos (or -1 if not found).
+ * @param ss   SL.
+ * @param c    Char to find.
+ * @param idx  Address of position storage.
+ * @param size Size of pre-allocated storage.
+ *
+ * @return Char count.
+ */
+sl_size_t sl_find_char_all( sl_t ss, char c, sl_pos_t** idx, sl_size_t size );
+
+
+/**
+ * Find "s2" from "s1". Return position or -1 if not found.
+ *
+ * "s2" can be SL or CSTR.
+ *
+ * @param s1  Base.
+ * @param s2  Find.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_find_index( sl_t s1, char* s2 );
+
+
+/**
+ * Create view of SL.
+ *
+ * View is a pointer and length pair, which refers to SL content
+ * without owning it. Views are passed by value and they are cheap
+ * to slice, hence substrings can be handled without allocation and
+ * copying. View is valid as long as the SL is not modified or
+ * deleted. View content is not null terminated.
+ *
+ * @param ss SL.
+ *
+ * @return View.
+ */
+sl_view_t sl_view( sl_t ss );
+
+
+/**
+ * Create view of CSTR.
+ *
+ * @param cs CSTR.
+ *
+ * @return View.
+ */
+sl_view_t sl_view_c( const char* cs );
+
+
+/**
+ * Select slice of view.
+ *
+ * Indeces are normalized as in sl_select_slice().
+ *
+ * @param v View.
+ * @param a Slice start.
+ * @param b Slice end.
+ *
+ * @return Slice view.
+ */
+sl_view_t sl_view_slice( sl_view_t v, sl_pos_t a, sl_pos_t b );
+
+
+/**
+ * Find "ndl" from view. Return position or -1 if not found.
+ *
+ * @param v   View.
+ * @param ndl Needle view.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_view_find( sl_view_t v, sl_view_t ndl );
+
+
+/**
+ * Find char towards right in view.
+ *
+ * @param v   View.
+ * @param c   Char to find.
+ * @param pos Search start pos.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_view_find_char( sl_view_t v, char c, sl_size_t pos );
+
+
+/**
+ * Compare views.
+ *
+ * Views are compared bytewise, and a shorter view is less than a
+ * longer view with the same prefix.
+ *
+ * @param v1 View 1.
+ * @param v2 View 2.
+ *
+ * @return 0 if same, -1 or 1 if different (as strcmp()).
+ */
+int sl_view_compare( sl_view_t v1, sl_view_t v2 );
+
+
+/**
+ * Create SL from view.
+ *
+ * @param v View.
+ *
+ * @return SL.
+ */
+sl_t sl_from_view( sl_view_t v );
+
+
+/**
+ * Begin string building.
+ *
+ * Builder collects fragments, and content is copied only once, when
+ * the final size is known. Strings are referred, not copied, hence
+ * they must be valid until sl_builder_end(). Numbers and chars are
+ * stored within the builder. Builder must not be copied (moved)
+ * while in use.
+ *
+ * Example:
+ * @code
+ *     sl_builder_t b;
+ *     sl_builder_begin( &b );
+ *     sl_builder_add_c( &b, "count: " );
+ *     sl_builder_add_i64( &b, cnt );
+ *     sl_builder_add_char( &b, '\n' );
+ *     sl_builder_end( &b, &ss );
+ * @endcode
+ *
+ * @param b Builder.
+ */
+void sl_builder_begin( sl_builder_t* b );
+
+
+/**
+ * Add SL to builder.
+ *
+ * @param b  Builder.
+ * @param ss SL.
+ */
+void sl_builder_add( sl_builder_t* b, sl_t ss );
+
+
+/**
+ * Add CSTR to builder.
+ *
+ * @param b  Builder.
+ * @param cs CSTR.
+ */
+void sl_builder_add_c( sl_builder_t* b, char* cs );
+
+
+/**
+ * Add view (pointer and length) to builder.
+ *
+ * @param b Builder.
+ * @param v View.
+ */
+void sl_builder_add_view( sl_builder_t* b, sl_view_t v );
+
+
+/**
+ * Add char to builder.
+ *
+ * @param b Builder.
+ * @param c Char.
+ */
+void sl_builder_add_char( sl_builder_t* b, char c );
+
+
+/**
+ * Add signed integer (decimal) to builder.
+ *
+ * @param b   Builder.
+ * @param i64 Integer.
+ */
+void sl_builder_add_i64( sl_builder_t* b, int64_t i64 );
+
+
+/**
+ * Add unsigned integer (decimal) to builder.
+ *
+ * @param b   Builder.
+ * @param u64 Integer.
+ */
+void sl_builder_add_u64( sl_builder_t* b, uint64_t u64 );
+
+
+/**
+ * Return builder content length.
+ *
+ * @param b Builder.
+ *
+ * @return Length.
+ */
+sl_size_t sl_builder_length( sl_builder_t* b );
+
+
+/**
+ * End string building and append content to SL.
+ *
+ * SL is reserved once for all content. If "*sp" is NULL, new SL is
+ * created. Builder is reset and can be re-used.
+ *
+ * @param b  Builder.
+ * @param sp SLP.
+ *
+ * @return SL.
  */
-int sl_find_index( sl_t s1, char* s2 );
+sl_t sl_builder_end( sl_builder_t* b, sl_p sp );
+
+
+/**
+ * Concatenate multiple CSTRs to SL, with one reservation.
+ *
+ * Argument list is terminated with NULL.
+ *
+ * @code
+ *     sl_concat_many( &ss, "a", "b", "c", NULL );
+ * @endcode
+ *
+ * @param sp  SLP.
+ * @param ... CSTRs.
+ *
+ * @return SL.
+ */
+sl_t sl_concat_many( sl_p sp, ... );
 
 
 /**
@@ -749,6 +1574,19 @@ int sl_divide_with_char( sl_t ss, char c, int size, char*** div );
 int sl_segment_with_str( sl_t ss, char* sc, int size, char*** div );
 
 
+/**
+ * Same as slseg() except segmentation is done using compiled pattern.
+ *
+ * @param ss   SL.
+ * @param pat  Pattern to split with.
+ * @param size Size of div storage (-1 for na).
+ * @param div  Address of div storage.
+ *
+ * @return Number of pieces.
+ */
+int sl_segment_with_pattern( sl_t ss, sl_pattern_t pat, int size, char*** div );
+
+
 /**
  * Glue (join) string array with string.
  *
@@ -789,6 +1627,48 @@ sl_t sl_glue_array( sl_v sa, sl_size_t size, char* glu );
 char* sl_tokenize( sl_t ss, char* delim, char** pos );
 
 
+/**
+ * Start split iteration of SL with "delim".
+ *
+ * Iterator returns tokens between delimiters as pointer and length
+ * pairs, using sl_split_next(). SL is not modified and nothing is
+ * allocated, hence multiple iterators (also in multiple threads)
+ * can be used for the same SL. SL must not be modified during
+ * iteration.
+ *
+ * Tokens match sl_segment_with_str(), i.e. N delimiters produce N+1
+ * tokens, some of which may be empty. Tokens are not null
+ * terminated.
+ *
+ * Example:
+ * @code
+ *     sl_split_iter_t it;
+ *     char*           tok;
+ *     sl_size_t       len;
+ *     sl_split_begin( &it, ss, "," );
+ *     while ( sl_split_next( &it, &tok, &len ) )
+ *         printf( "%.*s\n", (int)len, tok );
+ * @endcode
+ *
+ * @param it    Iterator.
+ * @param ss    SL.
+ * @param delim Delimiter string.
+ */
+void sl_split_begin( sl_split_iter_t* it, sl_t ss, char* delim );
+
+
+/**
+ * Get next token from split iterator.
+ *
+ * @param it  Iterator.
+ * @param ptr Token start.
+ * @param len Token length.
+ *
+ * @return 1 if token was returned, 0 at end of iteration.
+ */
+int sl_split_next( sl_split_iter_t* it, char** ptr, sl_size_t* len );
+
+
 /**
  * Drop the extension "ext" from "ss".
  *
@@ -848,6 +1728,101 @@ sl_t sl_swap_chars( sl_t ss, char f, char t );
 sl_t sl_map_str( sl_p sp, char* f, char* t );
 
 
+/**
+ * Map (replace) compiled pattern to "t" in "ss".
+ *
+ * @param sp  SLP.
+ * @param pat From pattern.
+ * @param t   To string.
+ *
+ * @return SL
+ */
+sl_t sl_map_pattern( sl_p sp, sl_pattern_t pat, char* t );
+
+
+/**
+ * Map (replace) multiple strings in one pass.
+ *
+ * Each "from[i]" is replaced with "to[i]". At each position the
+ * longest matching "from" string is replaced (leftmost-longest).
+ * Run time is linear in SL length, independent of "from" strings.
+ * Replaced text is not scanned again, hence the result is not the
+ * same as consecutive slmap() calls when replacements contain other
+ * "from" strings.
+ *
+ * @param sp   SLP.
+ * @param from From strings.
+ * @param to   To strings.
+ * @param n    Number of from/to pairs.
+ *
+ * @return SL.
+ */
+sl_t sl_map_many( sl_p sp, char** from, char** to, sl_size_t n );
+
+
+/**
+ * Compile search pattern.
+ *
+ * Pattern can be used for any number of searches, and it is
+ * independent of "needle" after compilation. Patterns of 4 chars or
+ * more include Horspool skip table.
+ *
+ * @param needle String to search for.
+ *
+ * @return Pattern.
+ */
+sl_pattern_t sl_pattern_compile( char* needle );
+
+
+/**
+ * Delete pattern.
+ *
+ * @param pp Pattern handle.
+ *
+ * @return NULL
+ */
+sl_pattern_t sl_pattern_del( sl_pattern_t* pp );
+
+
+/**
+ * Find pattern from SL.
+ *
+ * @param pat Pattern.
+ * @param ss  SL.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_pattern_find( sl_pattern_t pat, sl_t ss );
+
+
+/**
+ * Count (non-overlapping) pattern instances in SL.
+ *
+ * @param pat Pattern.
+ * @param ss  SL.
+ *
+ * @return Instance count.
+ */
+sl_size_t sl_pattern_count( sl_pattern_t pat, sl_t ss );
+
+
+/**
+ * Find all (non-overlapping) pattern instances in SL.
+ *
+ * Positions are stored to "idx", up to "size" positions. Return
+ * value is the total count of instances, which might be more than
+ * "size".
+ *
+ * @param pat  Pattern.
+ * @param ss   SL.
+ * @param idx  Storage for positions.
+ * @param size Size of idx storage.
+ *
+ * @return Instance count.
+ */
+sl_size_t sl_pattern_find_all( sl_pattern_t pat, sl_t ss, sl_pos_t* idx, sl_size_t size );
+
+
 /**
  * Capitalize SL, i.e. upcase the first letter.
  *
@@ -888,6 +1863,26 @@ sl_t sl_tolower( sl_t ss );
 sl_t sl_read_file( char* filename );
 
 
+/**
+ * Map file to read-only SL.
+ *
+ * File content is not copied, but SL shares the page cache pages of
+ * the file. SL can be passed to functions that take SLP, since they
+ * copy the content to heap first, but functions that take SL (e.g.
+ * sl_toupper()) must not be used. SL is unmapped with sl_del().
+ *
+ * "flags" give access hints to the kernel: SL_MMAP_SEQUENTIAL for
+ * sequential access (more read-ahead), and SL_MMAP_WILLNEED for
+ * starting read-ahead immediately.
+ *
+ * @param filename Name of file.
+ * @param flags    Mapping flags.
+ *
+ * @return SL (or NULL on error).
+ */
+sl_t sl_map_file( char* filename, int flags );
+
+
 /**
  * Write SL content to file.
  *
@@ -907,4 +1902,462 @@ sl_t sl_write_file( sl_t ss, char* filename );
 void sl_print( sl_t ss );
 
 
+/**
+ * Begin gap buffer editing of SL, with cursor at "pos".
+ *
+ * Spare storage of SL is used as gap, which is moved with the
+ * cursor. Edits at cursor are O(1), and moving the cursor is
+ * proportional to the distance moved. SL is not a valid string
+ * during editing, and it must only be accessed through gap
+ * functions. sl_gap_end() closes the gap and SL is usable again.
+ *
+ * Cursor positions are normalized as in sl_push_char_to().
+ *
+ * @param g   Gap state.
+ * @param sp  SLP.
+ * @param pos Cursor position.
+ */
+void sl_gap_begin( sl_gap_t* g, sl_p sp, sl_pos_t pos );
+
+
+/**
+ * Move gap cursor.
+ *
+ * @param g   Gap state.
+ * @param pos Cursor position.
+ */
+void sl_gap_move( sl_gap_t* g, sl_pos_t pos );
+
+
+/**
+ * Insert content at gap cursor, and move cursor after it.
+ *
+ * Storage is enlarged geometrically, when gap is exhausted. Content
+ * must not refer to the edited SL.
+ *
+ * @param g Gap state.
+ * @param v Content (view).
+ */
+void sl_gap_insert( sl_gap_t* g, sl_view_t v );
+
+
+/**
+ * Insert char at gap cursor, and move cursor after it.
+ *
+ * @param g Gap state.
+ * @param c Char.
+ */
+void sl_gap_push_char( sl_gap_t* g, char c );
+
+
+/**
+ * Delete chars after gap cursor.
+ *
+ * @param g   Gap state.
+ * @param cnt Char count.
+ */
+void sl_gap_delete( sl_gap_t* g, sl_size_t cnt );
+
+
+/**
+ * Delete chars before gap cursor.
+ *
+ * @param g   Gap state.
+ * @param cnt Char count.
+ */
+void sl_gap_backspace( sl_gap_t* g, sl_size_t cnt );
+
+
+/**
+ * Return content length during gap editing.
+ *
+ * @param g Gap state.
+ *
+ * @return Length.
+ */
+sl_size_t sl_gap_length( sl_gap_t* g );
+
+
+/**
+ * End gap buffer editing.
+ *
+ * Gap is moved to the end, and SL is terminated. Editing can be
+ * continued with sl_gap_begin().
+ *
+ * @param g Gap state.
+ *
+ * @return SL.
+ */
+sl_t sl_gap_end( sl_gap_t* g );
+
+
+/**
+ * Create rope with initial content.
+ *
+ * Rope stores content in chunks, hence insert, delete and position
+ * lookup are O(log n). Use sl_rope_flatten() to get the content as
+ * SL.
+ *
+ * @param init Initial content (view).
+ *
+ * @return Rope.
+ */
+sl_rope_t sl_rope_new( sl_view_t init );
+
+
+/**
+ * Delete rope.
+ *
+ * @param rp Rope handle.
+ *
+ * @return NULL
+ */
+sl_rope_t sl_rope_del( sl_rope_t* rp );
+
+
+/**
+ * Return rope content length.
+ *
+ * @param r Rope.
+ *
+ * @return Length.
+ */
+sl_size_t sl_rope_length( sl_rope_t r );
+
+
+/**
+ * Insert content to rope.
+ *
+ * Position is saturated to rope length.
+ *
+ * @param r   Rope.
+ * @param pos Insert position.
+ * @param v   Content (view).
+ */
+void sl_rope_insert( sl_rope_t r, sl_size_t pos, sl_view_t v );
+
+
+/**
+ * Delete content from rope.
+ *
+ * Length is saturated to rope end.
+ *
+ * @param r   Rope.
+ * @param pos Delete position.
+ * @param len Delete length.
+ */
+void sl_rope_delete( sl_rope_t r, sl_size_t pos, sl_size_t len );
+
+
+/**
+ * Copy rope content range to new SL.
+ *
+ * @param r   Rope.
+ * @param pos Slice position.
+ * @param len Slice length.
+ *
+ * @return SL.
+ */
+sl_t sl_rope_slice( sl_rope_t r, sl_size_t pos, sl_size_t len );
+
+
+/**
+ * Find "ndl" from rope, starting from "pos". Return position or -1
+ * if not found.
+ *
+ * Search is linear in searched content, and matches may cross chunk
+ * boundaries.
+ *
+ * @param r   Rope.
+ * @param ndl Needle view.
+ * @param pos Search start pos.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_rope_find( sl_rope_t r, sl_view_t ndl, sl_size_t pos );
+
+
+/**
+ * Return rope content as contiguous SL.
+ *
+ * @param r Rope.
+ *
+ * @return SL.
+ */
+sl_t sl_rope_flatten( sl_rope_t r );
+
+
+/**
+ * Create string table.
+ *
+ * Table strings are packed to one buffer, with a length field and
+ * null termination. Table keeps an offset per string, hence per
+ * string overhead is about 2 sl_size_t.
+ *
+ * @param size Initial string count capacity (0 for default).
+ *
+ * @return Table.
+ */
+sl_table_t sl_table_new( sl_size_t size );
+
+
+/**
+ * Delete string table.
+ *
+ * @param tp Table pointer.
+ *
+ * @return NULL
+ */
+sl_table_t sl_table_del( sl_table_t* tp );
+
+
+/**
+ * Append SL to table.
+ *
+ * Table storage may be moved, which invalidates earlier views to
+ * table.
+ *
+ * @param t  Table.
+ * @param ss SL.
+ *
+ * @return String index.
+ */
+sl_size_t sl_table_add( sl_table_t t, sl_t ss );
+
+
+/**
+ * Append C-string to table (see sl_table_add()).
+ *
+ * @param t  Table.
+ * @param cs C-string.
+ *
+ * @return String index.
+ */
+sl_size_t sl_table_add_c( sl_table_t t, char* cs );
+
+
+/**
+ * Append view to table (see sl_table_add()).
+ *
+ * @param t Table.
+ * @param v View.
+ *
+ * @return String index.
+ */
+sl_size_t sl_table_add_view( sl_table_t t, sl_view_t v );
+
+
+/**
+ * Return table string count.
+ *
+ * @param t Table.
+ *
+ * @return Count.
+ */
+sl_size_t sl_table_count( sl_table_t t );
+
+
+/**
+ * Return table string by index.
+ *
+ * View is null terminated.
+ *
+ * @param t   Table.
+ * @param idx String index.
+ *
+ * @return View.
+ */
+sl_view_t sl_table_get( sl_table_t t, sl_size_t idx );
+
+
+/**
+ * Sort table strings.
+ *
+ * Only string indexes are permuted. See sl_sort_with() for "flags".
+ *
+ * @param t     Table.
+ * @param flags Sort flags.
+ */
+void sl_table_sort( sl_table_t t, int flags );
+
+
+/**
+ * Join table strings with "glu" to new SL (see sl_glue_array()).
+ *
+ * @param t   Table.
+ * @param glu Glue string.
+ *
+ * @return SL.
+ */
+sl_t sl_table_join( sl_table_t t, char* glu );
+
+
+/**
+ * Iterate table strings in index order. "iter" is set to 0 before
+ * first call.
+ *
+ *     sl_size_t iter = 0;
+ *     while ( sl_table_next( tab, &iter, &v ) ) ...
+ *
+ * @param t    Table.
+ * @param iter Iteration state.
+ * @param v    String view.
+ *
+ * @return 1 if string was returned, 0 at end.
+ */
+int sl_table_next( sl_table_t t, sl_size_t* iter, sl_view_t* v );
+
+
+/**
+ * Create intern table.
+ *
+ * Table is split to shards with separate locks, hence multiple
+ * threads can intern concurrently.
+ *
+ * @return Intern table.
+ */
+sl_intern_t sl_intern_new( void );
+
+
+/**
+ * Delete intern table and all its canonical SLs.
+ *
+ * @param tp Intern table pointer.
+ *
+ * @return NULL
+ */
+sl_intern_t sl_intern_del( sl_intern_t* tp );
+
+
+/**
+ * Return canonical SL for "cs".
+ *
+ * Canonical SL is created on first call with the content. Canonical
+ * SL must not be modified or deleted, and it is valid until the table
+ * is deleted. Thread safe.
+ *
+ * @param t  Intern table.
+ * @param cs C-string.
+ *
+ * @return Canonical SL.
+ */
+sl_t sl_intern( sl_intern_t t, char* cs );
+
+
+/**
+ * Return canonical SL for view content (see sl_intern()).
+ *
+ * @param t Intern table.
+ * @param v View.
+ *
+ * @return Canonical SL.
+ */
+sl_t sl_intern_view( sl_intern_t t, sl_view_t v );
+
+
+/**
+ * Return count of canonical SLs in table.
+ *
+ * @param t Intern table.
+ *
+ * @return Count.
+ */
+sl_size_t sl_intern_count( sl_intern_t t );
+
+
+/**
+ * Create SL keyed hash map.
+ *
+ * Map is open addressing table with control bytes, which are probed
+ * 16 at a time. Map stores copies of keys, and values are not owned
+ * by the map.
+ *
+ * @param size Initial entry capacity.
+ *
+ * @return Map.
+ */
+sl_map_t sl_map_new( sl_size_t size );
+
+
+/**
+ * Delete map (and its keys).
+ *
+ * @param mp Map pointer.
+ *
+ * @return NULL
+ */
+sl_map_t sl_map_del( sl_map_t* mp );
+
+
+/**
+ * Put value for key. Existing value is replaced.
+ *
+ * @param m   Map.
+ * @param key Key.
+ * @param val Value.
+ */
+void sl_map_put( sl_map_t m, sl_t key, void* val );
+
+
+/**
+ * Get value for key.
+ *
+ * @param m   Map.
+ * @param key Key.
+ *
+ * @return Value or NULL if not found.
+ */
+void* sl_map_get( sl_map_t m, sl_t key );
+
+
+/**
+ * Is key in map?
+ *
+ * @param m   Map.
+ * @param key Key.
+ *
+ * @return 1 if found.
+ */
+int sl_map_has( sl_map_t m, sl_t key );
+
+
+/**
+ * Remove key from map.
+ *
+ * @param m   Map.
+ * @param key Key.
+ *
+ * @return 1 if removed, 0 if not found.
+ */
+int sl_map_remove( sl_map_t m, sl_t key );
+
+
+/**
+ * Return map entry count.
+ *
+ * @param m Map.
+ *
+ * @return Count.
+ */
+sl_size_t sl_map_count( sl_map_t m );
+
+
+/**
+ * Iterate map entries. "iter" is set to 0 before first call. Entry
+ * order is unspecified, and map must not be modified during
+ * iteration.
+ *
+ *     sl_size_t iter = 0;
+ *     while ( sl_map_next( map, &iter, &key, &val ) ) ...
+ *
+ * @param m    Map.
+ * @param iter Iteration state.
+ * @param key  Entry key (or NULL).
+ * @param val  Entry value (or NULL).
+ *
+ * @return 1 if entry was returned, 0 at end.
+ */
+int sl_map_next( sl_map_t m, sl_size_t* iter, sl_t* key, void** val );
+
+
 #endif
@@ -1,5 +1,7 @@
 #include "unity.h"
 #include "sl.h"
+#include <pthread.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -73,13 +75,51 @@ void test_basics( void )
     TEST_ASSERT( s2sl->len == 5 );
     sldel( &s2 );
 
-    s = sluse( malloc( 1024 ), 1024 );
+    sd = malloc( 1024 );
+    s = sluse( sd, 1024 );
     slcpy_c( &s, t1 );
     slcat( &s, s );
     slcat_c( &s, t1 );
     TEST_ASSERT_TRUE( !strcmp( s, "text1text1text1" ) );
 
     sldel( &s );
+    free( sd );
+}
+
+
+void test_use( void )
+{
+    _Alignas( 16 ) char buf[ 64 ];
+    sls                 s, s2;
+
+    /* Too small or misaligned. */
+    TEST_ASSERT( sluse( buf, 8 ) == NULL );
+    TEST_ASSERT( sluse( buf, sizeof( void* ) + 8 + 2 * sizeof( sl_size_t ) ) == NULL );
+    TEST_ASSERT( sluse( buf + 1, sizeof( buf ) - 1 ) == NULL );
+
+    s = sluse( buf, sizeof( buf ) );
+    TEST_ASSERT( slrss( s ) > 16 );
+    s2 = s;
+    slcpy_c( &s, "text1" );
+    TEST_ASSERT( s == s2 );
+
+    /* Compact has no effect on user storage. */
+    slcom( &s );
+    TEST_ASSERT( s == s2 );
+
+    /* Spill to heap. */
+    slfil( &s, 'a', 100 );
+    TEST_ASSERT( s != s2 );
+    TEST_ASSERT( sllen( s ) == 105 );
+    TEST_ASSERT( slrss( s ) == 106 );
+    TEST_ASSERT( slptr( s )->res == 106 );
+    TEST_ASSERT( s[ 4 ] == '1' );
+    TEST_ASSERT( slend( s ) == 'a' );
+    sldel( &s );
+
+    s = sluse( buf, sizeof( buf ) );
+    slcpy_c( &s, "text1" );
+    sldel( &s );
 }
 
 
@@ -108,6 +148,228 @@ void test_sizing( void )
 }
 
 
+void test_limit( void )
+{
+    _Alignas( 16 ) char buf[ 64 ];
+    sls                 s, s2;
+
+    /* First size beyond the limit collides with SL_EXT_FLAG. */
+    TEST_ASSERT( slnew( SL_EXT_FLAG ) == NULL );
+    TEST_ASSERT( sl_new_hashable( SL_EXT_FLAG ) == NULL );
+    TEST_ASSERT( sl_new_shareable( SL_EXT_FLAG ) == NULL );
+
+    s = slstr_c( "text1" );
+    s2 = s;
+    TEST_ASSERT( slres( &s, SL_EXT_FLAG ) == NULL );
+    TEST_ASSERT( sl_reserve_with( &s, SL_EXT_FLAG, SL_GROW_GEOMETRIC ) == NULL );
+    TEST_ASSERT( slfil( &s, 'a', SL_EXT_FLAG - 6 ) == NULL );
+    TEST_ASSERT( slmul( &s, "ab", SL_EXT_FLAG / 2 ) == NULL );
+    TEST_ASSERT( s == s2 );
+    TEST_ASSERT( !strcmp( s, "text1" ) );
+    TEST_ASSERT( slrss( s ) == 6 );
+    TEST_ASSERT( sllen( s ) == 5 );
+    sldel( &s );
+
+    /* User storage is clamped to the limit. */
+    s = sluse( buf, (sl_size_t)-1 );
+    TEST_ASSERT( slrss( s ) == SL_EXT_FLAG - 1 );
+    slcpy_c( &s, "text1" );
+    TEST_ASSERT( !strcmp( s, "text1" ) );
+    sldel( &s );
+}
+
+
+void test_growth( void )
+{
+    sls s;
+
+    s = slstr_c( "text1" );
+
+    sl_cfg_growth( SL_GROW_GEOMETRIC, 100 );
+    slcat_c( &s, "a" );
+    TEST_ASSERT( slrss( s ) == 12 );
+    TEST_ASSERT( sllen( s ) == 6 );
+    slcat_c( &s, "bcdef" );
+    TEST_ASSERT( slrss( s ) == 12 );
+    TEST_ASSERT( sllen( s ) == 11 );
+    slpsh( &s, 0, 'X' );
+    TEST_ASSERT_TRUE( !strcmp( s, "Xtext1abcdef" ) );
+    TEST_ASSERT( slrss( s ) == 24 );
+    slpsh( &s, -1, 'Y' );
+    TEST_ASSERT_TRUE( !strcmp( s, "Xtext1abcdeYf" ) );
+    TEST_ASSERT( slrss( s ) == 24 );
+
+    /* Explicit reservation is exact. */
+    slres( &s, 25 );
+    TEST_ASSERT( slrss( s ) == 25 );
+
+    sl_cfg_growth( SL_GROW_CLASS, 0 );
+    slfil( &s, 'a', 20 );
+    TEST_ASSERT( slrss( s ) == 64 - sizeof( sl_s ) );
+    TEST_ASSERT( sllen( s ) == 33 );
+
+    sl_cfg_growth( SL_GROW_EXACT, 50 );
+    slcat( &s, s );
+    TEST_ASSERT( slrss( s ) == 67 );
+    TEST_ASSERT( sllen( s ) == 66 );
+
+    slrsw( &s, 68, SL_GROW_GEOMETRIC );
+    TEST_ASSERT( slrss( s ) == 100 );
+    slrsw( &s, 90, SL_GROW_CLASS );
+    TEST_ASSERT( slrss( s ) == 100 );
+    slrsw( &s, 101, SL_GROW_CLASS );
+    TEST_ASSERT( slrss( s ) == 128 - sizeof( sl_s ) );
+
+    sldel( &s );
+}
+
+
+void test_arena( void )
+{
+    sl_arena_t a;
+    sls        s, s2;
+
+    a = sl_arena_new( 256 );
+
+    s = sl_from_str_in( a, "text1" );
+    TEST_ASSERT_TRUE( !strcmp( s, "text1" ) );
+    TEST_ASSERT( slrss( s ) == 6 );
+    TEST_ASSERT( sllen( s ) == 5 );
+
+    /* Latest allocation grows in place. */
+    s2 = s;
+    slcat_c( &s, "text2" );
+    TEST_ASSERT( s == s2 );
+    TEST_ASSERT_TRUE( !strcmp( s, "text1text2" ) );
+    TEST_ASSERT( slrss( s ) == 11 );
+
+    /* Other allocations move. */
+    s2 = sl_new_in( a, 16 );
+    slcpy_c( &s2, "text3" );
+    slcat( &s, s2 );
+    TEST_ASSERT_TRUE( !strcmp( s, "text1text2text3" ) );
+    TEST_ASSERT( slrss( s ) == 16 );
+
+    /* Bigger than chunk. */
+    slfil( &s2, 'a', 1000 );
+    TEST_ASSERT( sllen( s2 ) == 1005 );
+    TEST_ASSERT( slend( s2 ) == 'a' );
+
+    slcom( &s2 );
+    TEST_ASSERT( slrss( s2 ) == 1006 );
+    sldel( &s2 );
+    TEST_ASSERT( s2 == NULL );
+
+    sl_arena_reset( a );
+    s = sl_new_in( a, 16 );
+    slcpy_c( &s, "text4" );
+    TEST_ASSERT_TRUE( !strcmp( s, "text4" ) );
+    sldel( &s );
+
+    sl_arena_del( &a );
+    TEST_ASSERT( a == NULL );
+}
+
+
+static int pool_class( size_t size )
+{
+    int    cls = 0;
+    size_t block = 16;
+    while ( sizeof( sl_s ) + size > block ) {
+        block <<= 1;
+        cls++;
+    }
+    return cls;
+}
+
+
+static void* pool_free_thread( void* arg )
+{
+    sl_pool_stat_s st;
+
+    sldel( (sl_p)arg );
+    sl_pool_stat( &st );
+    TEST_ASSERT( st.free[ pool_class( 6 ) ] == 1 );
+
+    return NULL;
+}
+
+
+void test_pool( void )
+{
+    sls            s, s2;
+    sl_pool_stat_s st, st0;
+    int            c1, c2;
+    pthread_t      thr;
+
+    /* Enable with existing heap SL, resize within its class. */
+    s = slnew( 17 );
+    sl_cfg_pool( 1 );
+    slres( &s, 24 );
+    slfil( &s, 'a', 23 );
+    TEST_ASSERT( sllen( s ) == 23 );
+    TEST_ASSERT( slrss( s ) == 24 );
+    sldel( &s );
+    sl_pool_trim();
+    sl_pool_stat( &st0 );
+
+    s = slstr_c( "text1" );
+    c1 = pool_class( 6 );
+    sldel( &s );
+    sl_pool_stat( &st );
+    TEST_ASSERT( st.misses == st0.misses + 1 );
+    TEST_ASSERT( st.free[ c1 ] == 1 );
+
+    /* Re-use freed block. */
+    s = slstr_c( "text2" );
+    sl_pool_stat( &st );
+    TEST_ASSERT( st.hits == st0.hits + 1 );
+    TEST_ASSERT( st.used[ c1 ] == st0.used[ c1 ] + 1 );
+
+    /* Resize within class. */
+    s2 = s;
+    slres( &s, 8 );
+    TEST_ASSERT( s == s2 );
+    TEST_ASSERT( slrss( s ) == 8 );
+
+    /* Resize between classes. */
+    slcat_c( &s, "text3text4text5text6text7text8text9" );
+    TEST_ASSERT_TRUE( !strcmp( s, "text2text3text4text5text6text7text8text9" ) );
+    c2 = pool_class( 41 );
+    TEST_ASSERT( c1 != c2 );
+    sl_pool_stat( &st );
+    TEST_ASSERT( st.used[ c1 ] == st0.used[ c1 ] );
+    TEST_ASSERT( st.used[ c2 ] == st0.used[ c2 ] + 1 );
+    TEST_ASSERT( st.free[ c1 ] == 1 );
+
+    /* Beyond pool and back. */
+    slfil( &s, 'a', 1000 );
+    TEST_ASSERT( sllen( s ) == 1040 );
+    slcut( s, 1000 );
+    slcom( &s );
+    TEST_ASSERT_TRUE( !strcmp( s, "text2text3text4text5text6text7text8text9" ) );
+    TEST_ASSERT( slrss( s ) == 41 );
+    sl_pool_stat( &st );
+    TEST_ASSERT( st.used[ c2 ] == st0.used[ c2 ] + 1 );
+
+    sldel( &s );
+    sl_pool_trim();
+    sl_pool_stat( &st );
+    TEST_ASSERT( st.free[ c1 ] == 0 );
+    TEST_ASSERT( st.free[ c2 ] == 0 );
+
+    /* Free in another thread. */
+    s = slstr_c( "text1" );
+    pthread_create( &thr, NULL, pool_free_thread, &s );
+    pthread_join( thr, NULL );
+    sl_pool_stat( &st );
+    TEST_ASSERT( st.used[ c1 ] == st0.used[ c1 ] );
+    TEST_ASSERT( st.free[ c1 ] == 0 );
+
+    sl_cfg_pool( 0 );
+}
+
+
 void test_content( void )
 {
     sls s;
@@ -179,6 +441,16 @@ void test_content( void )
     TEST_ASSERT( slrss( s ) == 16 );
     TEST_ASSERT( sllen( s ) == 8 );
 
+    s2 = slnew( 4 );
+    slfmt( &s2, "%05d|%s", 42, t1 );
+    TEST_ASSERT_TRUE( !strcmp( s2, "00042|text1" ) );
+    TEST_ASSERT( slrss( s2 ) == 12 );
+    sl_format_hint( &s2, 100, "%c", 'x' );
+    TEST_ASSERT_TRUE( !strcmp( s2, "00042|text1x" ) );
+    TEST_ASSERT( slrss( s2 ) == 112 );
+    TEST_ASSERT( sllen( s2 ) == 12 );
+    sldel( &s2 );
+
     slfil( &s, 'a', 10 );
     TEST_ASSERT_TRUE( !strcmp( s, "__text1_aaaaaaaaaa" ) );
     TEST_ASSERT( slrss( s ) == 19 );
@@ -191,16 +463,89 @@ void test_content( void )
     TEST_ASSERT( sllen( s ) == 10 );
 
     slclr( s );
-    slfmq( &s, "_%s_%i_%I_%u_%U_%c_%%_%X", t1, -123456, 654321, 123456789, 9876543210, 'X' );
-    TEST_ASSERT_TRUE( !strcmp( s, "_text1_-123456_654321_123456789_9876543210_X_%_X" ) );
+    slfmq( &s, "_%s_%i_%I_%u_%U_%c_%%_%Z", t1, -123456, 654321, 123456789, 9876543210, 'X' );
+    TEST_ASSERT_TRUE( !strcmp( s, "_text1_-123456_654321_123456789_9876543210_X_%_Z" ) );
 
     s2 = slnew( 0 );
     slfmq( &s2, "%S%S", s, s );
     TEST_ASSERT_TRUE( !strcmp( s2,
-                               "_text1_-123456_654321_123456789_9876543210_X_%_X"
-                               "_text1_-123456_654321_123456789_9876543210_X_%_X" ) );
+                               "_text1_-123456_654321_123456789_9876543210_X_%_Z"
+                               "_text1_-123456_654321_123456789_9876543210_X_%_Z" ) );
+    sldel( &s );
+    sldel( &s2 );
+}
+
+
+void test_format_quick( void )
+{
+    sls  s;
+    char ref[ 128 ];
+
+    s = slnew( 0 );
+    slfmq( &s, "%d|%u|%x|%X|%05i|%-4i|%8.3f|%g|%f", 7, 100, 255, 0xabc, -42, 3, 3.14159, 1e-7, 0.1 );
+    TEST_ASSERT_TRUE( !strcmp( s, "7|100|ff|ABC|-0042|3   |   3.142|1e-07|0.1" ) );
+    TEST_ASSERT( sllen( s ) == strlen( s ) );
+
+    slclr( s );
+    slfmq( &s, "%lx|%08lX|%I|%U|%-3c|", 0xfedcba9876543210ULL, 0x1fULL, INT64_MIN, UINT64_MAX, 'q' );
+    TEST_ASSERT_TRUE(
+        !strcmp( s, "fedcba9876543210|0000001F|-9223372036854775808|18446744073709551615|q  |" ) );
+
+    /* Fixed precision matches printf. */
+    double vals[] = { 0.5, 1.5, 2.675, 1e21, -0.0, 123456.789, 1e-300, 0.125 };
+    for ( int i = 0; i < 8; i++ ) {
+        slclr( s );
+        slfmq( &s, "%.2f", vals[ i ] );
+        sprintf( ref, "%.2f", vals[ i ] );
+        TEST_ASSERT_TRUE( !strcmp( s, ref ) );
+    }
+
+    /* Shortest round-trip. */
+    slclr( s );
+    slfmq( &s, "%f %f %g %g", 0.3, 100.0, 1.5e300, 5e-324 );
+    TEST_ASSERT_TRUE( !strcmp( s, "0.3 100 1.5e+300 5e-324" ) );
+
+    sldel( &s );
+}
+
+
+void test_fmt_compile( void )
+{
+    sls      s, s2, s3;
+    sl_fmt_t f;
+
+    f = sl_fmt_compile( "[%s] %-6S|%05d %x %.2f %g 100%% %Z%" );
+    s = slnew( 0 );
+    s2 = slnew( 0 );
+    s3 = slstr_c( "abc" );
+    for ( int i = 0; i < 3; i++ ) {
+        slclr( s );
+        sl_fmt_apply( &s, f, "log", s3, -42, 255, 2.675, 1e-7 );
+        TEST_ASSERT_TRUE( !strcmp( s, "[log] abc   |-0042 ff 2.67 1e-07 100% Z" ) );
+        TEST_ASSERT( sllen( s ) == strlen( s ) );
+    }
+
+    /* Same output as slfmq(). */
+    slfmq( &s2, "[%s] %-6S|%05d %x %.2f %g 100%% %Z%", "log", s3, -42, 255, 2.675, 1e-7 );
+    TEST_ASSERT_TRUE( !strcmp( s, s2 ) );
+    sl_fmt_del( &f );
+    TEST_ASSERT( f == NULL );
+
+    /* More arguments than local storage, appending. */
+    f = sl_fmt_compile( "%i%i%i%i%i%i%i%i%i%i%i%i%i%i%i%i%i%i%i%i%f,%f" );
+    sl_fmt_apply( &s, f, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 0.5, 0.25 );
+    TEST_ASSERT_TRUE( !strcmp( s + sllen( s2 ), "12345678910111213141516171819200.5,0.25" ) );
+    sl_fmt_del( &f );
+
+    f = sl_fmt_compile( "" );
+    slclr( s );
+    sl_fmt_apply( &s, f );
+    TEST_ASSERT( sllen( s ) == 0 );
+    sl_fmt_del( &f );
+
     sldel( &s );
     sldel( &s2 );
+    sldel( &s3 );
 }
 
 
@@ -276,11 +621,424 @@ void test_examine( void )
 }
 
 
+void test_find( void )
+{
+    sls  s;
+    char ndl[ 65 ];
+
+    s = slstr_c( "aab" );
+    TEST_ASSERT( slidx( s, "ab" ) == 1 );
+    TEST_ASSERT( slidx( s, "aab" ) == 0 );
+    TEST_ASSERT( slidx( s, "aabb" ) == -1 );
+    sldel( &s );
+
+    /* Long haystack with match in every position class. */
+    s = slnew( 512 );
+    slfil( &s, 'a', 300 );
+    for ( int nlen = 1; nlen <= 64; nlen++ ) {
+        memset( ndl, 'a', nlen - 1 );
+        ndl[ nlen - 1 ] = 'b';
+        ndl[ nlen ] = 0;
+        TEST_ASSERT( slidx( s, ndl ) == -1 );
+        for ( int pos = nlen - 1; pos < 300; pos += 7 ) {
+            s[ pos ] = 'b';
+            TEST_ASSERT( slidx( s, ndl ) == pos - nlen + 1 );
+            s[ pos ] = 'a';
+        }
+    }
+    sldel( &s );
+}
+
+
+void test_find_char( void )
+{
+    sls       s;
+    sl_pos_t  buf[ 4 ];
+    sl_pos_t* idx;
+
+    /* Long SL with chars in every position class. */
+    s = slnew( 512 );
+    slfil( &s, 'a', 300 );
+    TEST_ASSERT( slfcr( s, 'b', 0 ) == -1 );
+    TEST_ASSERT( slfcl( s, 'b', 299 ) == -1 );
+    for ( int pos = 0; pos < 300; pos += 7 ) {
+        s[ pos ] = 'b';
+        TEST_ASSERT( slfcr( s, 'b', 0 ) == pos );
+        TEST_ASSERT( slfcr( s, 'b', pos ) == pos );
+        TEST_ASSERT( slfcl( s, 'b', 299 ) == pos );
+        TEST_ASSERT( slfcl( s, 'b', pos ) == pos );
+        if ( pos > 0 )
+            TEST_ASSERT( slfcl( s, 'b', pos - 1 ) == -1 );
+        s[ pos ] = 'a';
+    }
+    TEST_ASSERT( slfcr( s, 'a', 300 ) == -1 );
+
+    for ( int pos = 0; pos < 300; pos += 3 )
+        s[ pos ] = '\n';
+    idx = NULL;
+    TEST_ASSERT( slfca( s, '\n', &idx, 0 ) == 100 );
+    for ( int i = 0; i < 100; i++ )
+        TEST_ASSERT( idx[ i ] == 3 * i );
+    sl_free( idx );
+
+    idx = buf;
+    TEST_ASSERT( slfca( s, '\n', &idx, 4 ) == 100 );
+    TEST_ASSERT( buf[ 3 ] == 9 );
+    idx = NULL;
+    TEST_ASSERT( slfca( s, 'x', &idx, 0 ) == 0 );
+    sl_free( idx );
+    sldel( &s );
+
+    s = slstr_c( "/usr/local/lib/libsl.so" );
+    sldir( s );
+    TEST_ASSERT_TRUE( !strcmp( s, "/usr/local/lib" ) );
+    slbas( s );
+    TEST_ASSERT_TRUE( !strcmp( s, "lib" ) );
+    slbas( s );
+    TEST_ASSERT_TRUE( !strcmp( s, "lib" ) );
+    sldir( s );
+    TEST_ASSERT_TRUE( !strcmp( s, "." ) );
+    sldel( &s );
+    s = slstr_c( "/lib" );
+    sldir( s );
+    TEST_ASSERT_TRUE( !strcmp( s, "/" ) );
+    sldel( &s );
+}
+
+
+void test_view( void )
+{
+    sls       s, s2;
+    sl_view_t v, v2;
+
+    s = slstr_c( "key=value;next=1" );
+    v = sl_view( s );
+    TEST_ASSERT( v.ptr == s && v.len == 16 );
+
+    v2 = sl_view_slice( v, 0, sl_view_find_char( v, ';', 0 ) );
+    TEST_ASSERT( v2.len == 9 );
+    TEST_ASSERT( sl_view_find( v2, sl_view_c( "=" ) ) == 3 );
+    TEST_ASSERT( sl_view_find( v2, sl_view_c( "next" ) ) == -1 );
+    TEST_ASSERT( sl_view_find( v, sl_view_c( "next" ) ) == 10 );
+
+    v2 = sl_view_slice( v2, 4, 9 );
+    TEST_ASSERT( sl_view_compare( v2, sl_view_c( "value" ) ) == 0 );
+    TEST_ASSERT( sl_view_compare( v2, sl_view_c( "valu" ) ) > 0 );
+    TEST_ASSERT( sl_view_compare( v2, sl_view_c( "values" ) ) < 0 );
+    TEST_ASSERT( sl_view_compare( v2, sl_view_c( "vb" ) ) < 0 );
+    TEST_ASSERT( sl_view_compare( sl_view_c( "a" ), sl_view_c( "z" ) ) == -1 );
+    TEST_ASSERT( sl_view_compare( sl_view_c( "long prefix z" ), sl_view_c( "long prefix a" ) ) == 1 );
+    TEST_ASSERT( sl_view_find_char( v2, ';', 0 ) == -1 );
+
+    s2 = sl_from_view( v2 );
+    TEST_ASSERT_TRUE( !strcmp( s2, "value" ) );
+    TEST_ASSERT( sllen( s2 ) == 5 );
+    sldel( &s2 );
+
+    v2 = sl_view_slice( v, -1, -100 );
+    TEST_ASSERT( v2.ptr == s && v2.len == 15 );
+    v2 = sl_view_slice( v, 20, -1 );
+    TEST_ASSERT( v2.ptr == s + 15 && v2.len == 1 );
+
+    TEST_ASSERT_TRUE( !strcmp( s, "key=value;next=1" ) );
+    sldel( &s );
+}
+
+
+void test_builder( void )
+{
+    sls          s, s2;
+    sl_builder_t b;
+    char         ref[ 4096 ];
+    size_t       len;
+
+    s = NULL;
+    sl_builder_begin( &b );
+    sl_builder_add_c( &b, "id=" );
+    sl_builder_add_i64( &b, -42 );
+    sl_builder_add_char( &b, ',' );
+    sl_builder_add_u64( &b, 18446744073709551615ULL );
+    sl_builder_add_view( &b, sl_view_c( ";tail" ) );
+    TEST_ASSERT( sl_builder_length( &b ) == 32 );
+    sl_builder_end( &b, &s );
+    TEST_ASSERT_TRUE( !strcmp( s, "id=-42,18446744073709551615;tail" ) );
+    TEST_ASSERT( sllen( s ) == 32 );
+    TEST_ASSERT( slrss( s ) == 33 );
+
+    /* Many fragments, also from the SL itself. */
+    len = 32;
+    memcpy( ref, s, len );
+    for ( int i = 0; i < 100; i++ ) {
+        sl_builder_add( &b, s );
+        sl_builder_add_i64( &b, i );
+    }
+    sl_builder_end( &b, &s );
+    for ( int i = 0; i < 100; i++ ) {
+        memcpy( ref + len, ref, 32 );
+        len += 32;
+        len += sprintf( ref + len, "%d", i );
+    }
+    TEST_ASSERT( sllen( s ) == len );
+    TEST_ASSERT( !memcmp( s, ref, len ) );
+    sldel( &s );
+
+    s = slstr_c( "a" );
+    s2 = slstr_c( "d" );
+    sl_concat_many( &s, "b", "c", s2, "", "efg", NULL );
+    TEST_ASSERT_TRUE( !strcmp( s, "abcdefg" ) );
+    TEST_ASSERT( sllen( s ) == 7 );
+    sldel( &s );
+    sldel( &s2 );
+}
+
+
+void test_gap( void )
+{
+    sls      s, s2;
+    sl_gap_t gap;
+    char     ref[ 4096 ];
+    size_t   len, cur;
+
+    s = slstr_c( "hello world" );
+    sl_gap_begin( &gap, &s, 5 );
+    sl_gap_push_char( &gap, ',' );
+    sl_gap_delete( &gap, 1 );
+    sl_gap_insert( &gap, sl_view_c( " big " ) );
+    sl_gap_move( &gap, -1 );
+    sl_gap_delete( &gap, 10 );
+    sl_gap_backspace( &gap, 1 );
+    sl_gap_push_char( &gap, 'D' );
+    TEST_ASSERT( sl_gap_length( &gap ) == 15 );
+    sl_gap_end( &gap );
+    TEST_ASSERT_TRUE( !strcmp( s, "hello, big worD" ) );
+    TEST_ASSERT( sllen( s ) == 15 );
+
+    /* SL without storage. */
+    s2 = slnew( 0 );
+    sl_gap_begin( &gap, &s2, 0 );
+    sl_gap_insert( &gap, sl_view_c( "abcdefghijklmnopqrstuvwxyz" ) );
+    sl_gap_end( &gap );
+    TEST_ASSERT_TRUE( !strcmp( s2, "abcdefghijklmnopqrstuvwxyz" ) );
+    sldel( &s2 );
+
+    /* Random editing against plain reference. */
+    len = sllen( s );
+    memcpy( ref, s, len );
+    cur = 0;
+    srand( 2 );
+    sl_gap_begin( &gap, &s, 0 );
+    for ( int i = 0; i < 3000; i++ ) {
+        int op = rand() % 4;
+        if ( i % 100 == 0 ) {
+            cur = rand() % ( len + 1 );
+            sl_gap_move( &gap, cur );
+        } else if ( op < 2 && len < 4000 ) {
+            char c = 'a' + i % 26;
+            memmove( ref + cur + 1, ref + cur, len - cur );
+            ref[ cur++ ] = c;
+            len++;
+            sl_gap_push_char( &gap, c );
+        } else if ( op == 2 ) {
+            if ( cur < len ) {
+                memmove( ref + cur, ref + cur + 1, len - cur - 1 );
+                len--;
+            }
+            sl_gap_delete( &gap, 1 );
+        } else if ( cur > 0 ) {
+            memmove( ref + cur - 1, ref + cur, len - cur );
+            cur--;
+            len--;
+            sl_gap_backspace( &gap, 1 );
+        }
+        TEST_ASSERT( sl_gap_length( &gap ) == len );
+        if ( i % 500 == 0 ) {
+            sl_gap_end( &gap );
+            TEST_ASSERT( !memcmp( s, ref, len ) );
+            sl_gap_begin( &gap, &s, cur );
+        }
+    }
+    sl_gap_end( &gap );
+    TEST_ASSERT( sllen( s ) == len );
+    TEST_ASSERT( !memcmp( s, ref, len ) && s[ len ] == 0 );
+    sldel( &s );
+}
+
+
+void test_rope( void )
+{
+    sl_rope_t rope;
+    sls       s, s2;
+    char*     ref;
+    size_t    len;
+    char      txt[ 5001 ];
+
+    for ( int i = 0; i < 5000; i++ )
+        txt[ i ] = 'a' + i % 26;
+    txt[ 5000 ] = 0;
+
+    /* Random edits against plain reference. */
+    ref = malloc( 200000 );
+    len = 3000;
+    memcpy( ref, txt, len );
+    rope = sl_rope_new( sl_view_slice( sl_view_c( txt ), 0, len ) );
+    srand( 1 );
+    for ( int i = 0; i < 2000; i++ ) {
+        size_t pos = rand() % ( len + 1 );
+        size_t n = ( i % 50 == 0 ) ? 4500 : rand() % 40;
+        if ( rand() % 3 ) {
+            sl_view_t v = { txt + rand() % 26, n };
+            memmove( ref + pos + n, ref + pos, len - pos );
+            memcpy( ref + pos, v.ptr, n );
+            len += n;
+            sl_rope_insert( rope, pos, v );
+        } else {
+            if ( n > len - pos )
+                n = len - pos;
+            memmove( ref + pos, ref + pos + n, len - pos - n );
+            len -= n;
+            sl_rope_delete( rope, pos, n );
+        }
+        TEST_ASSERT( sl_rope_length( rope ) == len );
+    }
+
+    s = sl_rope_flatten( rope );
+    TEST_ASSERT( sllen( s ) == len );
+    TEST_ASSERT( !memcmp( s, ref, len ) );
+
+    s2 = sl_rope_slice( rope, 1234, 5678 );
+    TEST_ASSERT( sllen( s2 ) == 5678 );
+    TEST_ASSERT( !memcmp( s2, ref + 1234, 5678 ) );
+
+    /* Find every 97th position, matches cross chunks. */
+    for ( size_t pos = 0; pos + 30 < len; pos += 97 ) {
+        sl_view_t ndl = { ref + pos, 30 };
+        TEST_ASSERT( sl_rope_find( rope, ndl, pos ) == sl_view_find( sl_view_slice( sl_view( s ), pos, len ), ndl ) + (sl_pos_t)pos );
+    }
+    TEST_ASSERT( sl_rope_find( rope, sl_view_c( "a@" ), 0 ) == -1 );
+
+    sldel( &s );
+    sldel( &s2 );
+    sl_rope_del( &rope );
+    TEST_ASSERT( rope == NULL );
+    free( ref );
+
+    rope = sl_rope_new( sl_view_c( "" ) );
+    TEST_ASSERT( sl_rope_length( rope ) == 0 );
+    sl_rope_insert( rope, 10, sl_view_c( "world" ) );
+    sl_rope_insert( rope, 0, sl_view_c( "hello " ) );
+    sl_rope_delete( rope, 4, 100 );
+    sl_rope_insert( rope, 4, sl_view_c( "o!" ) );
+    s = sl_rope_flatten( rope );
+    TEST_ASSERT_TRUE( !strcmp( s, "hello!" ) );
+    sldel( &s );
+    sl_rope_del( &rope );
+}
+
+
+void test_split( void )
+{
+    sls             s;
+    sl_split_iter_t it1, it2;
+    char*           tok;
+    sl_size_t       len;
+    int             cnt;
+
+    s = slstr_c( "XYabcXYabcXY" );
+
+    /* Nested iterators on the same SL. */
+    cnt = 0;
+    sl_split_begin( &it1, s, "XY" );
+    while ( sl_split_next( &it1, &tok, &len ) ) {
+        int sub = 0;
+        sl_split_begin( &it2, s, "b" );
+        while ( sl_split_next( &it2, &tok, &len ) )
+            sub++;
+        TEST_ASSERT( sub == 3 );
+        cnt++;
+    }
+    TEST_ASSERT( cnt == 4 );
+    TEST_ASSERT_TRUE( !strcmp( s, "XYabcXYabcXY" ) );
+
+    sl_split_begin( &it1, s, "a" );
+    TEST_ASSERT( sl_split_next( &it1, &tok, &len ) );
+    TEST_ASSERT( tok == s && len == 2 );
+    TEST_ASSERT( sl_split_next( &it1, &tok, &len ) );
+    TEST_ASSERT( tok == s + 3 && len == 4 );
+    TEST_ASSERT( sl_split_next( &it1, &tok, &len ) );
+    TEST_ASSERT( tok == s + 8 && len == 4 );
+    TEST_ASSERT( !sl_split_next( &it1, &tok, &len ) );
+    TEST_ASSERT( !sl_split_next( &it1, &tok, &len ) );
+    sldel( &s );
+
+    s = slstr_c( ",a,,b," );
+    cnt = 0;
+    sl_split_begin( &it1, s, "," );
+    while ( sl_split_next( &it1, &tok, &len ) )
+        cnt++;
+    TEST_ASSERT( cnt == sldiv( s, ',', -1, NULL ) );
+    TEST_ASSERT( cnt == 5 );
+    sldel( &s );
+
+    s = slstr_c( "" );
+    sl_split_begin( &it1, s, "," );
+    TEST_ASSERT( sl_split_next( &it1, &tok, &len ) );
+    TEST_ASSERT( len == 0 );
+    TEST_ASSERT( !sl_split_next( &it1, &tok, &len ) );
+    sldel( &s );
+}
+
+
+void test_pattern( void )
+{
+    sls          s;
+    sl_pattern_t p1, p2;
+    sl_pos_t     idx[ 2 ];
+    char**       pcs;
+    int          cnt;
+
+    p1 = sl_pattern_compile( "XY" );
+    p2 = sl_pattern_compile( "abcX" );
+
+    s = slstr_c( "XYabcXYabcXY" );
+    TEST_ASSERT( sl_pattern_find( p1, s ) == 0 );
+    TEST_ASSERT( sl_pattern_find( p2, s ) == 2 );
+    TEST_ASSERT( sl_pattern_count( p1, s ) == 3 );
+    TEST_ASSERT( sl_pattern_count( p2, s ) == 2 );
+    TEST_ASSERT( sl_pattern_find_all( p2, s, idx, 2 ) == 2 );
+    TEST_ASSERT( idx[ 0 ] == 2 );
+    TEST_ASSERT( idx[ 1 ] == 7 );
+    TEST_ASSERT( sl_pattern_find_all( p1, s, idx, 2 ) == 3 );
+    TEST_ASSERT( idx[ 1 ] == 5 );
+
+    pcs = NULL;
+    cnt = sl_segment_with_pattern( s, p2, 0, &pcs );
+    TEST_ASSERT( cnt == 3 );
+    TEST_ASSERT_TRUE( !strcmp( pcs[ 0 ], "XY" ) );
+    TEST_ASSERT_TRUE( !strcmp( pcs[ 1 ], "Y" ) );
+    TEST_ASSERT_TRUE( !strcmp( pcs[ 2 ], "Y" ) );
+    sl_free( pcs );
+    sldel( &s );
+
+    s = slstr_c( "XYabcXYabcXY" );
+    sl_map_pattern( &s, p2, "_" );
+    TEST_ASSERT_TRUE( !strcmp( s, "XY_Y_Y" ) );
+    TEST_ASSERT( sl_pattern_find( p2, s ) == -1 );
+    sl_map_pattern( &s, p1, "GIG" );
+    TEST_ASSERT_TRUE( !strcmp( s, "GIG_Y_Y" ) );
+    sldel( &s );
+
+    sl_pattern_del( &p1 );
+    sl_pattern_del( &p2 );
+    TEST_ASSERT( p1 == NULL );
+}
+
+
 void test_pieces( void )
 {
     sls s, s2;
 
-    int cnt;
+    int    cnt;
+    char** pcs;
 
     s = slstr_c( "XYabcXYabcXY" );
     TEST_ASSERT( slrss( s ) == 13 );
@@ -295,7 +1053,15 @@ void test_pieces( void )
     cnt = sldiv( s, 'a', -1, NULL );
     TEST_ASSERT( cnt == 3 );
 
-    char** pcs;
+    s2 = slstr_c( "a,,b," );
+    pcs = NULL;
+    cnt = sldiv( s2, ',', 0, &pcs );
+    TEST_ASSERT( cnt == 4 );
+    TEST_ASSERT_TRUE( !strcmp( pcs[ 1 ], "" ) );
+    TEST_ASSERT_TRUE( !strcmp( pcs[ 2 ], "b" ) );
+    TEST_ASSERT_TRUE( !strcmp( pcs[ 3 ], "" ) );
+    sl_free( pcs );
+    sldel( &s2 );
 
     /* ------------------------------------------------------------
      * slsrt
@@ -401,8 +1167,187 @@ void test_pieces( void )
         TEST_ASSERT( sllen( s2 ) == 12 );
         slswp( s, 0, 'a' );
     }
+}
 
-    sl_free( pcs );
+
+static int sort_cmp( const void* a, const void* b )
+{
+    return strcmp( *(char* const*)a, *(char* const*)b );
+}
+
+
+void test_sort( void )
+{
+    sls      sa[ 2000 ];
+    sls      sb[ 2000 ];
+    char*    ca[ 2000 ];
+    char     buf[ 64 ];
+    unsigned seed = 1;
+    int      n = 2000;
+
+    /* Long common prefixes and short alphabet. */
+    for ( int i = 0; i < n; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        int len = ( seed >> 16 ) % 24;
+        strcpy( buf, ( i & 1 ) ? "prefix/common/" : "" );
+        int k = strlen( buf );
+        for ( int j = 0; j < len; j++ ) {
+            seed = seed * 1103515245 + 12345;
+            buf[ k++ ] = "ab\xe4z"[ ( seed >> 16 ) & 3 ];
+        }
+        buf[ k ] = 0;
+        sa[ i ] = slstr_c( buf );
+        sb[ i ] = sa[ i ];
+        ca[ i ] = sa[ i ];
+    }
+
+    qsort( sb, n, sizeof( char* ), sort_cmp );
+    slsrt( sa, n );
+    for ( int i = 0; i < n; i++ )
+        TEST_ASSERT_TRUE( !strcmp( sa[ i ], sb[ i ] ) );
+
+    sl_sort_cstr( ca, n, 0 );
+    for ( int i = 0; i < n; i++ )
+        TEST_ASSERT_TRUE( !strcmp( ca[ i ], sb[ i ] ) );
+
+    for ( int i = 0; i < n; i++ )
+        sldel( &sa[ i ] );
+
+    /* Stable sort, original index is hidden after null. */
+    for ( int i = 0; i < n; i++ ) {
+        sa[ i ] = slnew( 16 );
+        slfmq( &sa[ i ], "%i_%i", ( i * 7 ) % 13, i );
+        *strchr( sa[ i ], '_' ) = 0;
+    }
+    sl_sort_with( sa, n, SL_SORT_STABLE );
+    for ( int i = 1; i < n; i++ ) {
+        int c = strcmp( sa[ i - 1 ], sa[ i ] );
+        TEST_ASSERT( c < 0 || ( c == 0 && atoi( sa[ i - 1 ] + strlen( sa[ i - 1 ] ) + 1 )
+                                                < atoi( sa[ i ] + strlen( sa[ i ] ) + 1 ) ) );
+    }
+    for ( int i = 0; i < n; i++ )
+        sldel( &sa[ i ] );
+
+    /* Embedded null ends comparison, as in strcmp. */
+    sa[ 0 ] = slstr_c( "abcdefgh" );
+    sa[ 1 ] = slstr_c( "abcdefghij" );
+    sa[ 1 ][ 8 ] = 0;
+    sa[ 2 ] = slstr_c( "abc" );
+    sl_sort_with( sa, 3, SL_SORT_STABLE );
+    TEST_ASSERT_TRUE( !strcmp( sa[ 0 ], "abc" ) );
+    TEST_ASSERT( sllen( sa[ 1 ] ) == 8 );
+    TEST_ASSERT( sllen( sa[ 2 ] ) == 10 );
+    for ( int i = 0; i < 3; i++ )
+        sldel( &sa[ i ] );
+
+    /* Parallel, with many duplicates. */
+    n = 100000;
+    sls* pa = malloc( n * sizeof( sls ) );
+    sls* pb = malloc( n * sizeof( sls ) );
+    for ( int i = 0; i < n; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        pa[ i ] = slnew( 16 );
+        slfmq( &pa[ i ], "k%x", ( seed >> 8 ) % ( ( i & 1 ) ? 50 : 1000000 ) );
+        pb[ i ] = pa[ i ];
+    }
+    qsort( pb, n, sizeof( char* ), sort_cmp );
+    sl_sort_parallel( pa, n, 5 );
+    for ( int i = 0; i < n; i++ )
+        TEST_ASSERT_TRUE( !strcmp( pa[ i ], pb[ i ] ) );
+
+    /* Parallel, with few distinct strings. */
+    for ( int i = 0; i < n; i++ ) {
+        slclr( pa[ i ] );
+        slfmq( &pa[ i ], "d%d", i % 3 );
+        pb[ i ] = pa[ i ];
+    }
+    qsort( pb, n, sizeof( char* ), sort_cmp );
+    sl_sort_parallel( pa, n, 8 );
+    for ( int i = 0; i < n; i++ )
+        TEST_ASSERT_TRUE( !strcmp( pa[ i ], pb[ i ] ) );
+    for ( int i = 0; i < n; i++ )
+        sldel( &pa[ i ] );
+    free( pa );
+    free( pb );
+}
+
+
+static int sort_cmp_bin( const void* a, const void* b )
+{
+    return sl_compare_bin( *(sl_t const*)a, *(sl_t const*)b );
+}
+
+
+void test_compare_bin( void )
+{
+    sls      s1, s2;
+    sls      sa[ 1000 ];
+    sls      sb[ 1000 ];
+    unsigned seed = 3;
+    char     buf[ 40 ];
+
+    s1 = slsiz_c( "", 40 );
+    s2 = slsiz_c( "", 40 );
+
+    /* Lengths 0 to 20 cover all word compare paths. */
+    for ( int n = 0; n <= 20; n++ ) {
+        slclr( s1 );
+        slclr( s2 );
+        for ( int i = 0; i < n; i++ ) {
+            slpsh( &s1, sllen( s1 ), 'a' + i );
+            slpsh( &s2, sllen( s2 ), 'a' + i );
+        }
+        TEST_ASSERT( sl_compare_bin( s1, s2 ) == 0 );
+        TEST_ASSERT( sl_equal( s1, s2 ) );
+        for ( int i = 0; i < n; i++ ) {
+            s2[ i ] = (char)0xf0;
+            TEST_ASSERT( sl_compare_bin( s1, s2 ) == -1 );
+            TEST_ASSERT( sl_compare_bin( s2, s1 ) == 1 );
+            TEST_ASSERT( !sl_equal( s1, s2 ) );
+            s2[ i ] = s1[ i ];
+        }
+        slpsh( &s2, sllen( s2 ), 0 );
+        TEST_ASSERT( sl_compare_bin( s1, s2 ) == -1 );
+        TEST_ASSERT( !sl_equal( s1, s2 ) );
+        TEST_ASSERT( sldff( s1, s2 ) );
+    }
+
+    /* Embedded nulls. */
+    slclr( s1 );
+    slclr( s2 );
+    slcat_c( &s1, "ab" );
+    slcat_c( &s2, "ab" );
+    slpsh( &s1, sllen( s1 ), 0 );
+    slpsh( &s2, sllen( s2 ), 0 );
+    slcat_c( &s1, "x" );
+    slcat_c( &s2, "y" );
+    TEST_ASSERT( slcmp( s1, s2 ) == 0 );
+    TEST_ASSERT( sl_compare_bin( s1, s2 ) == -1 );
+    TEST_ASSERT( sldff( s1, s2 ) );
+    sldel( &s1 );
+    sldel( &s2 );
+
+    /* Binary sort, short alphabet with null. */
+    for ( int i = 0; i < 1000; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        int len = ( seed >> 16 ) % 20;
+        sa[ i ] = slnew( 32 );
+        for ( int j = 0; j < len; j++ ) {
+            seed = seed * 1103515245 + 12345;
+            buf[ 0 ] = "\0a\xff"[ ( seed >> 16 ) % 3 ];
+            slpsh( &sa[ i ], sllen( sa[ i ] ), buf[ 0 ] );
+        }
+        sb[ i ] = sa[ i ];
+    }
+    qsort( sb, 1000, sizeof( char* ), sort_cmp_bin );
+    sl_sort_with( sa, 1000, SL_SORT_BINARY );
+    for ( int i = 0; i < 1000; i++ )
+        TEST_ASSERT( sl_equal( sa[ i ], sb[ i ] ) );
+    sl_sort_with( sb, 1000, SL_SORT_BINARY | SL_SORT_STABLE );
+    for ( int i = 0; i < 1000; i++ )
+        TEST_ASSERT( sl_equal( sa[ i ], sb[ i ] ) );
+    for ( int i = 0; i < 1000; i++ )
+        sldel( &sa[ i ] );
 }
 
 
@@ -479,6 +1424,83 @@ void test_map( void )
     slmap( &s, "XY", "GG" );
     TEST_ASSERT_TRUE( !strcmp( s, "GGabcGGabc" ) );
     sldel( &s );
+
+    s = slstr_c( "XYabcXYabcXY" );
+    slmap( &s, "XY", "G" );
+    TEST_ASSERT_TRUE( !strcmp( s, "GabcGabcG" ) );
+    TEST_ASSERT( sllen( s ) == 9 );
+    sldel( &s );
+}
+
+
+void test_map_many( void )
+{
+    sls   s;
+    char* f1[] = { "&", "<", ">" };
+    char* t1[] = { "&amp;", "&lt;", "&gt;" };
+    char* f2[] = { "bc", "abcd", "d" };
+    char* t2[] = { "[BC]", "[ABCD]", "" };
+    char* f3[] = { "aaaa", "c" };
+    char* t3[] = { "b", "dddd" };
+
+    s = slstr_c( "<a href=\"x&y\">" );
+    sl_map_many( &s, f1, t1, 3 );
+    TEST_ASSERT_TRUE( !strcmp( s, "&lt;a href=\"x&amp;y\"&gt;" ) );
+    TEST_ASSERT( sllen( s ) == strlen( "&lt;a href=\"x&amp;y\"&gt;" ) );
+    sldel( &s );
+
+    /* Leftmost-longest. */
+    s = slstr_c( "xabcdbcdd" );
+    sl_map_many( &s, f2, t2, 3 );
+    TEST_ASSERT_TRUE( !strcmp( s, "x[ABCD][BC]" ) );
+    sldel( &s );
+
+    /* Shrink before grow. */
+    s = slstr_c( "aaaaaaaaccc" );
+    sl_map_many( &s, f3, t3, 2 );
+    TEST_ASSERT_TRUE( !strcmp( s, "bbdddddddddddd" ) );
+    TEST_ASSERT( sllen( s ) == 14 );
+    sldel( &s );
+
+    /* Grow before shrink. */
+    s = slstr_c( "caaaaaaaaa" );
+    sl_map_many( &s, f3, t3, 2 );
+    TEST_ASSERT_TRUE( !strcmp( s, "ddddbba" ) );
+    sldel( &s );
+
+    s = slstr_c( "none" );
+    sl_map_many( &s, f3, t3, 2 );
+    TEST_ASSERT_TRUE( !strcmp( s, "none" ) );
+    TEST_ASSERT( sllen( s ) == 4 );
+    sldel( &s );
+
+    /* Matches after a match, which overlap a failed longer match. */
+    char* f4[] = { "a", "abcd", "b", "zx", "zxabq", "xab", "ab" };
+    char* t4[] = { "1", "2", "3", "4", "5", "6", "7" };
+    s = slstr_c( "abx zxabr" );
+    sl_map_many( &s, f4, t4, 7 );
+    TEST_ASSERT_TRUE( !strcmp( s, "7x 47r" ) );
+    sldel( &s );
+
+    /* Long failing pattern over many short matches. */
+    char* f5[] = { "a", NULL };
+    char* t5[] = { "b", "c" };
+    f5[ 1 ] = slnew( 1100 );
+    slfil( &f5[ 1 ], 'a', 1000 );
+    slcat_c( &f5[ 1 ], "b" );
+    s = slnew( 20001 );
+    slfil( &s, 'a', 20000 );
+    sl_map_many( &s, f5, t5, 2 );
+    TEST_ASSERT( sllen( s ) == 20000 );
+    TEST_ASSERT( strspn( s, "b" ) == 20000 );
+    slcat( &s, f5[ 1 ] );
+    slpsh( &s, 0, 'a' );
+    sl_map_many( &s, f5, t5, 2 );
+    TEST_ASSERT( sllen( s ) == 20002 );
+    TEST_ASSERT( strspn( s, "b" ) == 20001 );
+    TEST_ASSERT( s[ 20001 ] == 'c' );
+    sldel( &s );
+    sldel( &f5[ 1 ] );
 }
 
 
@@ -503,6 +1525,41 @@ line5\n\
     sldel( &s2 );
     TEST_ASSERT( s == NULL );
     TEST_ASSERT( s2 == NULL );
+
+    /* Mapped file. */
+    s2 = sl_map_file( "test_file.txt", SL_MMAP_SEQUENTIAL | SL_MMAP_WILLNEED );
+    TEST_ASSERT( !strcmp( s2, filetext ) );
+    TEST_ASSERT( sllen( s2 ) == strlen( filetext ) );
+    s = slstr_c( filetext );
+    TEST_ASSERT( sl_hash( s2 ) == sl_hash( s ) );
+    sldel( &s );
+
+    /* Modification copies to heap. */
+    slcat_c( &s2, "line6\n" );
+    TEST_ASSERT( !strncmp( s2, filetext, strlen( filetext ) ) );
+    TEST_ASSERT( !strcmp( s2 + strlen( filetext ), "line6\n" ) );
+    sldel( &s2 );
+
+    /* Page sized content is null terminated too. */
+    s = slnew( 8192 );
+    slfil( &s, 'x', 8192 );
+    slwrf( s, "test_file.txt" );
+    s2 = sl_map_file( "test_file.txt", 0 );
+    TEST_ASSERT( sllen( s2 ) == 8192 );
+    TEST_ASSERT( s2[ 8192 ] == 0 );
+    TEST_ASSERT( sl_equal( s, s2 ) );
+    sldel( &s );
+    sldel( &s2 );
+
+    s = slnew( 1 );
+    slwrf( s, "test_file.txt" );
+    s2 = sl_map_file( "test_file.txt", 0 );
+    TEST_ASSERT( sllen( s2 ) == 0 );
+    TEST_ASSERT( s2[ 0 ] == 0 );
+    sldel( &s );
+    sldel( &s2 );
+
+    TEST_ASSERT( sl_map_file( "no_such_file.txt", 0 ) == NULL );
 }
 
 
@@ -594,3 +1651,389 @@ void test_path( void )
 
     sldel( &s );
 }
+
+
+void test_hash_map( void )
+{
+    sl_t     s1, s2, s3;
+    uint32_t h;
+
+    /* Hash caching and invalidation. */
+    s1 = sl_new_hashable( 8 );
+    slcat_c( &s1, "hash key" );
+    s2 = slstr_c( "hash key" );
+    h = sl_hash( s1 );
+    TEST_ASSERT( h != 0 );
+    TEST_ASSERT( h == sl_hash( s2 ) );
+
+    /* Direct write is not seen before reset. */
+    s1[ 0 ] = 'c';
+    TEST_ASSERT( sl_hash( s1 ) == h );
+    sl_hash_reset( s1 );
+    TEST_ASSERT( sl_hash( s1 ) != h );
+    TEST_ASSERT( !sl_equal( s1, s2 ) );
+    s1[ 0 ] = 'h';
+    sl_hash_reset( s1 );
+
+    slcat_c( &s1, " that grows beyond initial storage" );
+    TEST_ASSERT( sl_hash( s1 ) != h );
+    sllim( s1, 8 );
+    TEST_ASSERT( sl_hash( s1 ) == h );
+    sltou( s1 );
+    TEST_ASSERT( sl_hash( s1 ) != h );
+    sltol( s1 );
+    TEST_ASSERT( sl_hash( s1 ) == h );
+    sl_format_quick( &s1, "%d", 1 );
+    TEST_ASSERT( sl_hash( s1 ) != h );
+    sl_cut( s1, 1 );
+    TEST_ASSERT( sl_hash( s1 ) == h );
+    sl_compact( &s1 );
+    TEST_ASSERT( sl_hash( s1 ) == h );
+
+    /* Cached hashes reject without content compare. */
+    s3 = sl_new_hashable( 8 );
+    slcpy_c( &s3, "hash kez" );
+    sl_hash( s3 );
+    TEST_ASSERT( sl_equal( s1, s1 ) );
+    TEST_ASSERT( sldff( s1, s3 ) );
+    slcpy_c( &s3, "hash key" );
+    sl_hash( s3 );
+    TEST_ASSERT( sl_equal( s1, s3 ) );
+
+    /* Lengths differ in hash. */
+    slclr( s3 );
+    slpsh( &s3, 0, 0 );
+    TEST_ASSERT( sl_hash( s3 ) != sl_hash( s2 ) );
+    slclr( s2 );
+    TEST_ASSERT( sl_hash( s3 ) != sl_hash( s2 ) );
+
+    sldel( &s1 );
+    sldel( &s2 );
+    sldel( &s3 );
+
+    /* Map. */
+    sl_map_t  map;
+    sl_t      key, k;
+    void*     v;
+    sl_size_t iter, cnt;
+    int       n = 5000;
+
+    map = sl_map_new( 0 );
+    key = slnew( 16 );
+    for ( int i = 0; i < n; i++ ) {
+        slclr( key );
+        slfmq( &key, "key-%d", i );
+        sl_map_put( map, key, (void*)(intptr_t)( i + 1 ) );
+    }
+    TEST_ASSERT( sl_map_count( map ) == (sl_size_t)n );
+
+    for ( int i = 0; i < n; i++ ) {
+        slclr( key );
+        slfmq( &key, "key-%d", i );
+        TEST_ASSERT( sl_map_get( map, key ) == (void*)(intptr_t)( i + 1 ) );
+    }
+    slcpy_c( &key, "key-" );
+    TEST_ASSERT( !sl_map_has( map, key ) );
+    TEST_ASSERT( sl_map_get( map, key ) == NULL );
+
+    /* Replace. */
+    slcpy_c( &key, "key-7" );
+    sl_map_put( map, key, (void*)1 );
+    TEST_ASSERT( sl_map_get( map, key ) == (void*)1 );
+    TEST_ASSERT( sl_map_count( map ) == (sl_size_t)n );
+
+    /* Remove odd keys, then churn to reuse removed slots. */
+    for ( int i = 1; i < n; i += 2 ) {
+        slclr( key );
+        slfmq( &key, "key-%d", i );
+        TEST_ASSERT( sl_map_remove( map, key ) );
+        TEST_ASSERT( !sl_map_remove( map, key ) );
+    }
+    TEST_ASSERT( sl_map_count( map ) == (sl_size_t)n / 2 );
+    for ( int r = 0; r < 4; r++ ) {
+        for ( int i = 0; i < n; i++ ) {
+            slclr( key );
+            slfmq( &key, "tmp-%d", i );
+            sl_map_put( map, key, NULL );
+        }
+        for ( int i = 0; i < n; i++ ) {
+            slclr( key );
+            slfmq( &key, "tmp-%d", i );
+            sl_map_remove( map, key );
+        }
+    }
+    for ( int i = 0; i < n; i++ ) {
+        slclr( key );
+        slfmq( &key, "key-%d", i );
+        TEST_ASSERT( sl_map_has( map, key ) == !( i & 1 ) );
+    }
+
+    /* Iterate. */
+    iter = 0;
+    cnt = 0;
+    while ( sl_map_next( map, &iter, &k, &v ) ) {
+        TEST_ASSERT( !strncmp( k, "key-", 4 ) );
+        TEST_ASSERT( sl_map_get( map, k ) == v );
+        cnt++;
+    }
+    TEST_ASSERT( cnt == (sl_size_t)n / 2 );
+
+    /* Binary keys. */
+    slclr( key );
+    slpsh( &key, 0, 0 );
+    sl_map_put( map, key, (void*)2 );
+    slclr( key );
+    TEST_ASSERT( !sl_map_has( map, key ) );
+    sl_map_put( map, key, (void*)3 );
+    TEST_ASSERT( sl_map_get( map, key ) == (void*)3 );
+    slpsh( &key, 0, 0 );
+    TEST_ASSERT( sl_map_get( map, key ) == (void*)2 );
+
+    sldel( &key );
+    sl_map_del( &map );
+    TEST_ASSERT( map == NULL );
+}
+
+
+static void* intern_worker( void* arg )
+{
+    sl_intern_t tab = arg;
+    char        buf[ 32 ];
+    sl_t        ss;
+
+    for ( int i = 0; i < 4000; i++ ) {
+        sprintf( buf, "metric.%d", i % 1000 );
+        ss = sl_intern( tab, buf );
+        if ( strcmp( ss, buf ) || ss != sl_intern( tab, buf ) )
+            return NULL;
+    }
+
+    return arg;
+}
+
+
+void test_intern( void )
+{
+    sl_intern_t tab;
+    sl_t        s1, s2, s3;
+    char        bin[] = "a\0b";
+    pthread_t   th[ 4 ];
+    void*       ret;
+
+    tab = sl_intern_new();
+
+    s1 = sl_intern( tab, "localhost" );
+    s2 = slstr_c( "localhost" );
+    TEST_ASSERT( !strcmp( s1, "localhost" ) );
+    TEST_ASSERT( sllen( s1 ) == 9 );
+    TEST_ASSERT( sl_intern( tab, s2 ) == s1 );
+    TEST_ASSERT( sl_intern_view( tab, sl_view( s2 ) ) == s1 );
+    TEST_ASSERT( sl_intern( tab, "localhos" ) != s1 );
+    TEST_ASSERT( sl_equal( s1, s2 ) );
+    TEST_ASSERT( sl_hash( s1 ) == sl_hash( s2 ) );
+    sldel( &s2 );
+
+    /* Binary content. */
+    s3 = sl_intern_view( tab, ( sl_view_t ){ bin, 3 } );
+    TEST_ASSERT( sllen( s3 ) == 3 );
+    TEST_ASSERT( s3[ 2 ] == 'b' );
+    TEST_ASSERT( sl_intern( tab, "a" ) != s3 );
+    TEST_ASSERT( sl_intern_view( tab, ( sl_view_t ){ bin, 3 } ) == s3 );
+    TEST_ASSERT( sl_intern( tab, "" ) == sl_intern( tab, "" ) );
+    TEST_ASSERT( sl_intern_count( tab ) == 5 );
+
+    /* Concurrent interning. */
+    for ( int i = 0; i < 4; i++ )
+        pthread_create( &th[ i ], NULL, intern_worker, tab );
+    for ( int i = 0; i < 4; i++ ) {
+        pthread_join( th[ i ], &ret );
+        TEST_ASSERT( ret == tab );
+    }
+    TEST_ASSERT( sl_intern_count( tab ) == 1005 );
+
+    sl_intern_del( &tab );
+    TEST_ASSERT( tab == NULL );
+}
+
+
+static void* share_worker( void* arg )
+{
+    sl_t ss = arg;
+    sl_t ret;
+
+    /* Detach and modify own reference. */
+    ret = slstr_c( ss );
+    slcat_c( &ss, "!" );
+    if ( strcmp( ss, "payload!" ) )
+        sldel( &ret );
+    sldel( &ss );
+
+    return ret;
+}
+
+
+void test_share( void )
+{
+    sl_t      s1, s2, s3, s4;
+    pthread_t th[ 4 ];
+    void*     ret;
+    uint32_t  h;
+
+    s1 = slstr_c( "payload" );
+    s2 = sl_share( s1 );
+    TEST_ASSERT( s2 != s1 );
+    TEST_ASSERT( sl_equal( s1, s2 ) );
+    TEST_ASSERT( sl_hash( s1 ) == sl_hash( s2 ) );
+
+    /* Share is O(1). */
+    s3 = sl_share( s2 );
+    TEST_ASSERT( s3 == s2 );
+
+    /* SLP functions detach. */
+    slcat_c( &s3, " more" );
+    TEST_ASSERT( s3 != s2 );
+    TEST_ASSERT( !strcmp( s3, "payload more" ) );
+    TEST_ASSERT( !strcmp( s2, "payload" ) );
+    TEST_ASSERT( sllen( s2 ) == 7 );
+    sldel( &s3 );
+
+    s3 = sl_share( s2 );
+    sl_map_str( &s3, "pay", "" );
+    TEST_ASSERT( !strcmp( s3, "load" ) );
+    TEST_ASSERT( !strcmp( s2, "payload" ) );
+    sldel( &s3 );
+
+    s3 = sl_share( s2 );
+    s4 = sl_share( s2 );
+    slfmq( &s3, "%d", 1 );
+    slins_c( &s4, 0, "my " );
+    TEST_ASSERT( !strcmp( s3, "payload1" ) );
+    TEST_ASSERT( !strcmp( s4, "my payload" ) );
+    TEST_ASSERT( !strcmp( s2, "payload" ) );
+    sldel( &s3 );
+    sldel( &s4 );
+
+    /* Fan out to threads. */
+    for ( int i = 0; i < 4; i++ )
+        pthread_create( &th[ i ], NULL, share_worker, sl_share( s2 ) );
+    for ( int i = 0; i < 4; i++ ) {
+        pthread_join( th[ i ], &ret );
+        TEST_ASSERT( ret != NULL );
+        s3 = ret;
+        TEST_ASSERT( !strcmp( s3, "payload" ) );
+        sldel( &s3 );
+    }
+    TEST_ASSERT( !strcmp( s2, "payload" ) );
+
+    /* Sole reference is modified in place. */
+    sl_reserve( &s2, 64 );
+    s3 = s2;
+    slpsh( &s2, 0, '>' );
+    TEST_ASSERT( s2 == s3 );
+    TEST_ASSERT( !strcmp( s2, ">payload" ) );
+    TEST_ASSERT( sl_hash( s2 ) != sl_hash( s1 ) );
+
+    sldel( &s1 );
+    sldel( &s2 );
+
+    /* Shareable storage, first share is O(1). */
+    s1 = sl_new_shareable( 8 );
+    slcat_c( &s1, "payload" );
+    s3 = slstr_c( "payload" );
+    s2 = sl_share( s1 );
+    TEST_ASSERT( s2 == s1 );
+    TEST_ASSERT( sl_hash( s1 ) == sl_hash( s3 ) );
+    sldel( &s3 );
+
+    /* Hash of shared SL is kept. */
+    h = sl_hash( s1 );
+    sl_hash_reset( s1 );
+    TEST_ASSERT( sl_hash( s2 ) == h );
+    slcat_c( &s2, "2" );
+    TEST_ASSERT( s2 != s1 );
+    TEST_ASSERT( !strcmp( s1, "payload" ) );
+    TEST_ASSERT( sl_hash( s2 ) != sl_hash( s1 ) );
+
+    sldel( &s1 );
+    sldel( &s2 );
+}
+
+
+void test_table( void )
+{
+    sl_table_t tab;
+    sl_view_t  v;
+    sl_size_t  iter;
+    sl_t       ss;
+    char       bin[] = "ab\0a";
+    char       buf[ 32 ];
+    char*      words[] = { "pear", "apple", "fig", "", "apple pie", "banana" };
+    char*      sorted[] = { "", "apple", "apple pie", "banana", "fig", "pear" };
+
+    tab = sl_table_new( 2 );
+    TEST_ASSERT( sl_table_count( tab ) == 0 );
+    ss = sl_table_join( tab, ", " );
+    TEST_ASSERT( sllen( ss ) == 0 );
+    sldel( &ss );
+
+    for ( int i = 0; i < 6; i++ )
+        TEST_ASSERT( sl_table_add_c( tab, words[ i ] ) == (sl_size_t)i );
+    TEST_ASSERT( sl_table_count( tab ) == 6 );
+
+    v = sl_table_get( tab, 1 );
+    TEST_ASSERT( v.len == 5 );
+    TEST_ASSERT( !strcmp( v.ptr, "apple" ) );
+    v = sl_table_get( tab, 3 );
+    TEST_ASSERT( v.len == 0 );
+
+    ss = sl_table_join( tab, "," );
+    TEST_ASSERT( !strcmp( ss, "pear,apple,fig,,apple pie,banana" ) );
+    TEST_ASSERT( sllen( ss ) == 32 );
+    sldel( &ss );
+
+    sl_table_sort( tab, 0 );
+    iter = 0;
+    while ( sl_table_next( tab, &iter, &v ) ) {
+        TEST_ASSERT( !strcmp( v.ptr, sorted[ iter - 1 ] ) );
+        TEST_ASSERT( v.len == strlen( sorted[ iter - 1 ] ) );
+    }
+    TEST_ASSERT( iter == 6 );
+
+    /* Binary content. */
+    ss = slstr_c( "ab" );
+    sl_table_add( tab, ss );
+    sl_table_add_view( tab, ( sl_view_t ){ bin, 4 } );
+    sl_table_add_view( tab, ( sl_view_t ){ bin, 3 } );
+    sl_table_sort( tab, SL_SORT_BINARY );
+    TEST_ASSERT( sl_table_get( tab, 1 ).len == 2 );
+    TEST_ASSERT( sl_table_get( tab, 2 ).len == 3 );
+    TEST_ASSERT( sl_table_get( tab, 3 ).len == 4 );
+    TEST_ASSERT( !memcmp( sl_table_get( tab, 3 ).ptr, bin, 4 ) );
+    TEST_ASSERT( !strcmp( sl_table_get( tab, 4 ).ptr, "apple" ) );
+    sldel( &ss );
+    sl_table_del( &tab );
+    TEST_ASSERT( tab == NULL );
+
+    /* Growth, and stable sort by first char. */
+    tab = sl_table_new( 0 );
+    for ( int i = 0; i < 10000; i++ ) {
+        sprintf( buf, "%c%05d", 'a' + ( i * 7 ) % 26, i );
+        sl_table_add_c( tab, buf );
+    }
+    sl_table_sort( tab, SL_SORT_STABLE );
+    for ( sl_size_t i = 1; i < sl_table_count( tab ); i++ ) {
+        sl_view_t a = sl_table_get( tab, i - 1 );
+        sl_view_t b = sl_table_get( tab, i );
+        TEST_ASSERT( sl_view_compare( a, b ) < 0 );
+    }
+    sl_table_del( &tab );
+
+    /* Append table's own strings while table grows. */
+    tab = sl_table_new( 1 );
+    sl_table_add_c( tab, "self" );
+    for ( int i = 0; i < 1000; i++ )
+        sl_table_add_view( tab, sl_table_get( tab, i ) );
+    TEST_ASSERT( sl_table_count( tab ) == 1001 );
+    TEST_ASSERT( !strcmp( sl_table_get( tab, 1000 ).ptr, "self" ) );
+    sl_table_del( &tab );
+}
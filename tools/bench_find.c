@@ -0,0 +1,149 @@
+/**
+ * @file   bench_find.c
+ *
+ * @brief  Substring search benchmark.
+ *
+ * Compares sl_find_index() to a byte loop (the search before
+ * vectorization) and memmem(). Haystack is random text of letters
+ * 'a' to 'y', and it ends with the needle. Needle is random letters
+ * followed by 'z', hence it is found only at the end, and the whole
+ * haystack is scanned.
+ *
+ * Build and run:
+ *
+ *     gcc -O2 -Isrc src/sl.c tools/bench_find.c -o bench_find -lpthread
+ *     ./bench_find
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sl.h"
+
+
+/** Haystack length. */
+#define HAY_LEN ( 1 << 20 )
+
+/** Searches per measurement. */
+#define ROUNDS 200
+
+/** Compiler barrier, keeps pure search calls in the loop. */
+#define barrier( p ) __asm__ volatile( "" : : "r"( p ) : "memory" )
+
+
+/**
+ * Find needle with a byte loop, i.e. the search before vectorization
+ * (with needle index reset after partial match).
+ *
+ * @param s1 Haystack.
+ * @param s2 Needle.
+ *
+ * @return Pos (or -1 if not found).
+ */
+static sl_pos_t find_loop( const char* s1, const char* s2 )
+{
+    sl_size_t i1 = 0;
+    sl_size_t i2, i;
+
+    if ( s2[ 0 ] == 0 )
+        return -1;
+
+    while ( s1[ i1 ] ) {
+        i = i1;
+        i2 = 0;
+        while ( s1[ i ] == s2[ i2 ] && s2[ i2 ] ) {
+            i++;
+            i2++;
+        }
+        if ( s2[ i2 ] == 0 )
+            return i1;
+        i1++;
+    }
+
+    return -1;
+}
+
+
+/**
+ * Return monotonic time in seconds.
+ */
+static double now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+int main( void )
+{
+    int      lens[] = { 1, 2, 3, 4, 8, 16, 32, 64 };
+    sl_t     hay;
+    char*    buf;
+    char     ndl[ 65 ];
+    uint32_t seed = 1;
+    sl_pos_t pos, sink = 0;
+    double   t0, t1, t2, t3;
+
+    buf = malloc( HAY_LEN + 1 );
+    hay = sl_new( HAY_LEN + 1 );
+
+    printf( "haystack %d bytes, %d rounds, GB/s\n", HAY_LEN, ROUNDS );
+    printf( "%6s %10s %10s %10s\n", "needle", "loop", "memmem", "sl_find" );
+
+    for ( size_t k = 0; k < sizeof( lens ) / sizeof( lens[ 0 ] ); k++ ) {
+        int nlen = lens[ k ];
+
+        for ( int i = 0; i < HAY_LEN; i++ ) {
+            seed = seed * 1103515245 + 12345;
+            buf[ i ] = 'a' + ( seed >> 16 ) % 25;
+        }
+        buf[ HAY_LEN - 1 ] = 'z';
+        buf[ HAY_LEN ] = 0;
+        sl_copy_c( &hay, buf );
+        memcpy( ndl, hay + HAY_LEN - nlen, nlen );
+        ndl[ nlen ] = 0;
+        pos = sl_find_index( hay, ndl );
+        if ( pos != HAY_LEN - nlen ) {
+            printf( "needle of length %d not at end\n", nlen );
+            return 1;
+        }
+
+        t0 = now();
+        for ( int r = 0; r < ROUNDS; r++ ) {
+            barrier( hay );
+            sink += find_loop( hay, ndl );
+        }
+        t1 = now();
+        for ( int r = 0; r < ROUNDS; r++ ) {
+            barrier( hay );
+            sink += (char*)memmem( hay, HAY_LEN, ndl, nlen ) - hay;
+        }
+        t2 = now();
+        for ( int r = 0; r < ROUNDS; r++ ) {
+            barrier( hay );
+            sink += sl_find_index( hay, ndl );
+        }
+        t3 = now();
+
+        if ( find_loop( hay, ndl ) != pos || (char*)memmem( hay, HAY_LEN, ndl, nlen ) - hay != pos ) {
+            printf( "mismatch at needle length %d\n", nlen );
+            return 1;
+        }
+
+        printf( "%6d %10.2f %10.2f %10.2f\n",
+                nlen,
+                (double)HAY_LEN * ROUNDS / ( t1 - t0 ) / 1e9,
+                (double)HAY_LEN * ROUNDS / ( t2 - t1 ) / 1e9,
+                (double)HAY_LEN * ROUNDS / ( t3 - t2 ) / 1e9 );
+    }
+
+    sl_del( &hay );
+    free( buf );
+
+    return sink == 0;
+}
@@ -0,0 +1,335 @@
+/**
+ * @file   bench_ops.c
+ *
+ * @brief  Benchmark for common SL operations.
+ *
+ * Each case is run "RUNS" times, and the fastest run is reported,
+ * which filters out most of the scheduling noise.
+ *
+ * Build and run:
+ *
+ *     gcc -O2 -Isrc src/sl.c tools/bench_ops.c -o bench_ops -lpthread
+ *     ./bench_ops
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sl.h"
+
+
+/** Runs per case. */
+#define RUNS 7
+
+/** Text length for search cases. */
+#define TEXT_LEN 65536
+
+/** Insert count for insert_at and rope_at cases. */
+#define INSERT_CNT 1000
+
+/** String count for sort cases. */
+#define SORT_CNT ( 1 << 19 )
+
+/** Compiler barrier, keeps pure search calls in the loop. */
+#define barrier( p ) __asm__ volatile( "" : : "r"( p ) : "memory" )
+
+
+/** Random text of letters 'a' to 'y'. */
+static char text[ TEXT_LEN + 1 ];
+
+/** Conversions for quick format cases. */
+enum { FMT_INT, FMT_HEX, FMT_PAD, FMT_F, FMT_G };
+
+/** Random strings of 8 to 23 letters for sort cases. */
+static sl_t strs[ SORT_CNT ];
+
+/** Result sink, defeats dead code elimination. */
+static long sink;
+
+
+/**
+ * Return monotonic time in seconds.
+ */
+static double now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/**
+ * Append short words, 50 SLs of 1 MB.
+ */
+static void bench_cat( void )
+{
+    for ( int r = 0; r < 50; r++ ) {
+        sl_t s = sl_new( 16 );
+        for ( int i = 0; i < 200000; i++ )
+            sl_concatenate_c( &s, "word " );
+        sink += sl_length( s );
+        sl_del( &s );
+    }
+}
+
+
+/**
+ * Insert to the middle of growing SL.
+ */
+static void bench_insert( void )
+{
+    for ( int r = 0; r < 20; r++ ) {
+        sl_t s = sl_new( 16 );
+        for ( int i = 0; i < 20000; i++ )
+            sl_insert_to_c( &s, i / 2, "xy" );
+        sink += sl_length( s );
+        sl_del( &s );
+    }
+}
+
+
+/**
+ * Find missing and late needles from text.
+ */
+static void bench_find( void )
+{
+    sl_t s = sl_from_str_c( text );
+
+    for ( int r = 0; r < 2000; r++ ) {
+        barrier( s );
+        sink += sl_find_index( s, "zzq" );
+        sink += sl_find_index( s, text + 60000 );
+    }
+
+    sl_del( &s );
+}
+
+
+/**
+ * Replace to longer and to shorter strings.
+ */
+static void bench_map_str( void )
+{
+    for ( int r = 0; r < 300; r++ ) {
+        sl_t s = sl_from_str_c( text );
+        sl_map_str( &s, "ab", "xyz" );
+        sl_map_str( &s, "xyz", "q" );
+        sink += sl_length( s );
+        sl_del( &s );
+    }
+}
+
+
+/**
+ * Insert 5 bytes to random positions of SL of "size" bytes.
+ */
+static void bench_insert_at( size_t size )
+{
+    sl_t     s = sl_from_view( ( sl_view_t ){ text, size < TEXT_LEN ? size : TEXT_LEN } );
+    uint32_t seed = 1;
+
+    while ( sl_length( s ) < size )
+        sl_concatenate_c( &s, text );
+
+    for ( int i = 0; i < INSERT_CNT; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        sl_insert_to_c( &s, ( (uint64_t)seed * sl_length( s ) ) >> 32, "patch" );
+    }
+
+    sink += sl_length( s );
+    sl_del( &s );
+}
+
+
+/**
+ * Insert 5 bytes to random positions of rope of "size" bytes.
+ */
+static void bench_rope_at( size_t size )
+{
+    sl_rope_t r = sl_rope_new( ( sl_view_t ){ text, size < TEXT_LEN ? size : TEXT_LEN } );
+    uint32_t  seed = 1;
+
+    while ( sl_rope_length( r ) < size )
+        sl_rope_insert( r, sl_rope_length( r ), sl_view_c( text ) );
+
+    for ( int i = 0; i < INSERT_CNT; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        sl_rope_insert( r, ( (uint64_t)seed * sl_rope_length( r ) ) >> 32, sl_view_c( "patch" ) );
+    }
+
+    sink += sl_rope_length( r );
+    sl_rope_del( &r );
+}
+
+
+/**
+ * Format short output to SL with spare storage.
+ */
+static void bench_format( void )
+{
+    sl_t s = sl_new( 8192 );
+
+    for ( int i = 0; i < 200000; i++ ) {
+        sl_clear( s );
+        sl_format( &s, "item %s: %d (0x%x)", "name", i, i );
+        sink += sl_length( s );
+    }
+
+    sl_del( &s );
+}
+
+
+/**
+ * Format long output (two 2 KB strings) to SL with spare storage.
+ */
+static void bench_format_long( void )
+{
+    sl_t s = sl_new( 8192 );
+
+    for ( int i = 0; i < 20000; i++ ) {
+        sl_clear( s );
+        sl_format( &s, "%s%s", text + TEXT_LEN - 2048, text + TEXT_LEN - 2048 );
+        sink += sl_length( s );
+    }
+
+    sl_del( &s );
+}
+
+
+/**
+ * Quick format single conversion of "kind" to SL.
+ */
+static void bench_quick( size_t kind )
+{
+    sl_t s = sl_new( 64 );
+
+    for ( int i = 0; i < 200000; i++ ) {
+        sl_clear( s );
+        switch ( kind ) {
+            case FMT_INT: sl_format_quick( &s, "%d", i * 7919 ); break;
+            case FMT_HEX: sl_format_quick( &s, "%x", i * 7919 ); break;
+            case FMT_PAD: sl_format_quick( &s, "%08x %-8s", i, "ab" ); break;
+            case FMT_F: sl_format_quick( &s, "%.3f", i * 0.37 ); break;
+            case FMT_G: sl_format_quick( &s, "%g", i * 0.37 ); break;
+        }
+        sink += sl_length( s );
+    }
+
+    sl_del( &s );
+}
+
+
+/**
+ * Format single conversion of "kind" with snprintf(), baseline for
+ * quick format. Note that "%g" gives 6 digits, where quick format
+ * gives the shortest round-trip digits.
+ */
+static void bench_snprintf( size_t kind )
+{
+    char buf[ 64 ];
+
+    for ( int i = 0; i < 200000; i++ ) {
+        switch ( kind ) {
+            case FMT_INT: sink += snprintf( buf, sizeof( buf ), "%d", i * 7919 ); break;
+            case FMT_HEX: sink += snprintf( buf, sizeof( buf ), "%x", i * 7919 ); break;
+            case FMT_PAD: sink += snprintf( buf, sizeof( buf ), "%08x %-8s", i, "ab" ); break;
+            case FMT_F: sink += snprintf( buf, sizeof( buf ), "%.3f", i * 0.37 ); break;
+            case FMT_G: sink += snprintf( buf, sizeof( buf ), "%g", i * 0.37 ); break;
+        }
+        barrier( buf );
+    }
+}
+
+
+/**
+ * Sort strings with "nthr" threads.
+ */
+static void bench_sort_par( size_t nthr )
+{
+    sl_t* sa = malloc( SORT_CNT * sizeof( sl_t ) );
+
+    memcpy( sa, strs, SORT_CNT * sizeof( sl_t ) );
+    sl_sort_parallel( sa, SORT_CNT, nthr );
+    sink += sa[ 0 ][ 0 ];
+
+    free( sa );
+}
+
+
+/** Benchmark case, with or without argument. */
+typedef struct
+{
+    const char* name;
+    void ( *fn )( void );
+    void ( *fn_arg )( size_t arg );
+    size_t arg;
+} bench_s;
+
+
+int main( void )
+{
+    bench_s  cases[] = {
+        { "cat", bench_cat },
+        { "insert", bench_insert },
+        { "find", bench_find },
+        { "map_str", bench_map_str },
+        { "insert_at/1k", NULL, bench_insert_at, 1 << 10 },
+        { "rope_at/1k", NULL, bench_rope_at, 1 << 10 },
+        { "insert_at/1m", NULL, bench_insert_at, 1 << 20 },
+        { "rope_at/1m", NULL, bench_rope_at, 1 << 20 },
+        { "insert_at/100m", NULL, bench_insert_at, 100 << 20 },
+        { "rope_at/100m", NULL, bench_rope_at, 100 << 20 },
+        { "format", bench_format },
+        { "format_long", bench_format_long },
+        { "quick_int", NULL, bench_quick, FMT_INT },
+        { "snprintf_int", NULL, bench_snprintf, FMT_INT },
+        { "quick_hex", NULL, bench_quick, FMT_HEX },
+        { "snprintf_hex", NULL, bench_snprintf, FMT_HEX },
+        { "quick_pad", NULL, bench_quick, FMT_PAD },
+        { "snprintf_pad", NULL, bench_snprintf, FMT_PAD },
+        { "quick_f", NULL, bench_quick, FMT_F },
+        { "snprintf_f", NULL, bench_snprintf, FMT_F },
+        { "quick_g", NULL, bench_quick, FMT_G },
+        { "snprintf_g", NULL, bench_snprintf, FMT_G },
+        { "sort_par/1", NULL, bench_sort_par, 1 },
+        { "sort_par/2", NULL, bench_sort_par, 2 },
+        { "sort_par/4", NULL, bench_sort_par, 4 },
+        { "sort_par/8", NULL, bench_sort_par, 8 },
+        { "sort_par/16", NULL, bench_sort_par, 16 },
+    };
+    uint32_t seed = 1;
+    double   t, best;
+
+    for ( int i = 0; i < TEXT_LEN; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        text[ i ] = 'a' + ( seed >> 16 ) % 25;
+    }
+
+    for ( int i = 0; i < SORT_CNT; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        strs[ i ] = sl_from_view( ( sl_view_t ){ text + i % ( TEXT_LEN - 32 ), 8 + ( seed >> 16 ) % 16 } );
+    }
+
+    for ( size_t k = 0; k < sizeof( cases ) / sizeof( cases[ 0 ] ); k++ ) {
+        best = 1e9;
+        for ( int r = 0; r < RUNS; r++ ) {
+            t = now();
+            if ( cases[ k ].fn )
+                cases[ k ].fn();
+            else
+                cases[ k ].fn_arg( cases[ k ].arg );
+            t = now() - t;
+            if ( t < best )
+                best = t;
+        }
+        printf( "%-16s %10.6f s\n", cases[ k ].name, best );
+    }
+
+    for ( int i = 0; i < SORT_CNT; i++ )
+        sl_del( &strs[ i ] );
+
+    return sink == 0;
+}